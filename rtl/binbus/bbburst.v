@@ -0,0 +1,83 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	bbburst.v
+// {{{
+// Project:	dbgbus, a collection of 8b channel to WB bus debugging protocols
+//
+// Purpose:	Expands the burst read commands of the binary framed debugging
+//		bus into the individual read commands hbexec understands.  A
+//	read command word (2'b00) carries the number of additional reads to
+//	issue in its bottom four bits.  Since the burst is expanded after the
+//	command FIFO (hbfifo), a burst of up to sixteen reads only uses one
+//	slot within that FIFO.  All other command words are passed through
+//	unchanged.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+// }}}
+// Copyright (C) 2021, Gisselquist Technology, LLC
+// {{{
+// This file is part of the hexbus debugging interface.
+//
+// The hexbus interface is free software (firmware): you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// The hexbus interface is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  (It's in the $(ROOT)/doc directory.  Run make
+// with no target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+// }}}
+// License:	LGPL, v3, as defined and found on www.gnu.org,
+// {{{
+//		http://www.gnu.org/licenses/lgpl.html
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+`default_nettype	none
+// }}}
+module	bbburst (
+		// {{{
+		input	wire		i_clk, i_reset,
+		//
+		input	wire		i_stb,
+		input	wire	[33:0]	i_word,
+		output	wire		o_busy,
+		//
+		output	wire		o_stb,
+		output	wire	[33:0]	o_word,
+		input	wire		i_busy
+		// }}}
+	);
+
+	reg	[3:0]	r_count;
+
+	// r_count
+	// {{{
+	// The number of reads remaining to be issued from the current burst
+	initial	r_count = 0;
+	always @(posedge i_clk)
+	if (i_reset)
+		r_count <= 0;
+	else if (!i_busy)
+	begin
+		if (r_count != 0)
+			r_count <= r_count - 1'b1;
+		else if ((i_stb)&&(i_word[33:32] == 2'b00))
+			r_count <= i_word[3:0];
+	end
+	// }}}
+
+	assign	o_stb  = (i_stb)||(r_count != 0);
+	assign	o_word = (r_count != 0) ? 34'h0 : i_word;
+	assign	o_busy = (i_busy)||(r_count != 0);
+
+endmodule
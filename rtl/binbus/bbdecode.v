@@ -0,0 +1,321 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	bbdecode.v
+// {{{
+// Project:	dbgbus, a collection of 8b channel to WB bus debugging protocols
+//
+// Purpose:	Decodes the incoming (7-bit) byte stream of the binary framed
+//		debugging bus into the same 34-bit command words used by the
+//	hexbus (hbexec).  Only bytes with the high bit set belong to the bus,
+//	those with it clear belong to the console.
+//
+//	Every frame starts with a header byte, 7'b1cc_nnnn:
+//
+//	7'b100_nnnn	Read (n+1) words.  No payload follows.  This becomes a
+//			single read command, with n in the bottom four bits,
+//			to be expanded by bbburst.
+//	7'b101_nnnn	Write (n+1) words.  (n+1) 32-bit payloads follow.
+//	7'b110_xxxx	Set address.  A single 32-bit payload follows, with the
+//			same meaning as the hexbus address word: bit[0] for no
+//			increment, bit[1] to add the value to the current
+//			address.
+//	7'b111_1111	Reset the bus
+//
+//	Any other byte received when a header is expected is ignored.
+//
+//	32-bit payloads are sent as five bytes, most significant first:
+//	7'b000_dddd with the top four bits of the word, followed by four bytes
+//	of seven bits each.  Should anything other than a 7'b000_dddd byte
+//	arrive where the first byte of a payload is expected, the frame is
+//	abandoned and that byte taken as the next header.  Hence, five reset
+//	bytes in a row will always reset the bus, no matter where the decoder
+//	thought it was.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+// }}}
+// Copyright (C) 2021, Gisselquist Technology, LLC
+// {{{
+// This file is part of the hexbus debugging interface.
+//
+// The hexbus interface is free software (firmware): you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// The hexbus interface is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  (It's in the $(ROOT)/doc directory.  Run make
+// with no target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+// }}}
+// License:	LGPL, v3, as defined and found on www.gnu.org,
+// {{{
+//		http://www.gnu.org/licenses/lgpl.html
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+`default_nettype	none
+// }}}
+module	bbdecode (
+		// {{{
+		input	wire		i_clk,
+		// The incoming byte stream
+		input	wire		i_stb,
+		input	wire	[7:0]	i_byte,
+		// The outgoing command word stream
+		output	reg		o_reset,
+		output	reg		o_stb,
+		output	reg	[33:0]	o_word
+		// }}}
+	);
+
+	// Local declarations
+	// {{{
+	wire		w_stb, w_header;
+	wire	[6:0]	w_byte;
+	reg	[1:0]	r_cmd;
+	reg	[3:0]	r_nwords;
+	reg	[2:0]	r_nbytes;
+	reg	[24:0]	r_word;
+	// }}}
+
+	assign	w_stb  = (i_stb)&&(i_byte[7]);
+	assign	w_byte = i_byte[6:0];
+
+	// We are looking at a header any time we aren't in the middle of a
+	// payload, or when the first byte of a payload isn't valid
+	assign	w_header = (r_nbytes == 0)
+			||((r_nbytes == 3'd5)&&(w_byte[6:4] != 3'b000));
+
+	// o_reset
+	// {{{
+	initial	o_reset = 1'b1;
+	always @(posedge i_clk)
+		o_reset <= (w_stb)&&(w_header)&&(w_byte == 7'h7f);
+	// }}}
+
+	// r_cmd, r_nwords, r_nbytes
+	// {{{
+	initial	r_nbytes = 0;
+	initial	r_nwords = 0;
+	always @(posedge i_clk)
+	if (o_reset)
+	begin
+		r_nbytes <= 0;
+		r_nwords <= 0;
+	end else if ((w_stb)&&(w_header))
+	begin
+		r_cmd    <= w_byte[5:4];
+		r_nwords <= 0;
+		r_nbytes <= 0;
+		if ((w_byte[6:4] == 3'b101)||(w_byte[6:4] == 3'b110))
+			// Write or address, each with at least one payload
+			r_nbytes <= 3'd5;
+		if (w_byte[6:4] == 3'b101)
+			// Writes may have up to fifteen more
+			r_nwords <= w_byte[3:0];
+	end else if (w_stb)
+	begin
+		r_nbytes <= r_nbytes - 1'b1;
+		if (r_nbytes == 3'd1)
+		begin
+			// That was the last byte of this payload.  Are there
+			// any more to come within this same frame?
+			if (r_nwords != 0)
+				r_nbytes <= 3'd5;
+			r_nwords <= r_nwords - ((r_nwords != 0) ? 1'b1 : 1'b0);
+		end
+	end
+	// }}}
+
+	// r_word
+	// {{{
+	always @(posedge i_clk)
+	if ((w_stb)&&(!w_header))
+	begin
+		if (r_nbytes == 3'd5)
+			r_word <= { 21'h0, w_byte[3:0] };
+		else
+			r_word <= { r_word[17:0], w_byte };
+	end
+	// }}}
+
+	// o_stb, o_word
+	// {{{
+	initial	o_stb = 1'b0;
+	always @(posedge i_clk)
+	if (o_reset)
+		o_stb <= 1'b0;
+	else if ((w_stb)&&(w_header))
+		// Reads need no payload, and so they can be issued at once
+		o_stb <= (w_byte[6:4] == 3'b100);
+	else
+		o_stb <= (w_stb)&&(r_nbytes == 3'd1);
+
+	always @(posedge i_clk)
+	if ((w_stb)&&(w_header))
+		o_word <= { 2'b00, 28'h0, w_byte[3:0] };
+	else if (w_stb)
+		o_word <= { r_cmd, r_word, w_byte };
+	// }}}
+////////////////////////////////////////////////////////////////////////////////
+//
+// Formal properties
+// {{{
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+`ifdef	FORMAL
+`ifdef	BBDECODE
+`define	ASSUME	assume
+`else
+`define	ASSUME	assert
+`endif
+	// Feed the decoder whole frames, as binbus.cpp builds them.  f_nbytes
+	// and f_nwords count the payload bytes left in the current word and
+	// the words left after it, f_cmd is the command the frame's header
+	// asked for, and f_word holds the payload bits received so far.  From
+	// these, we know which command word every frame must produce.
+	reg		f_past_valid;
+	reg	[2:0]	f_nbytes;
+	reg	[3:0]	f_nwords;
+	reg	[1:0]	f_cmd;
+	reg	[24:0]	f_word;
+	reg		f_expect_stb, f_expect_reset;
+	reg	[33:0]	f_expect_word;
+	reg	[2:0]	f_seq;
+	wire		f_bus;
+
+	initial	f_past_valid = 1'b0;
+	always @(posedge i_clk)
+		f_past_valid <= 1'b1;
+
+	assign	f_bus = (i_stb)&&(i_byte[7]);
+
+	// Bytes come from a serial port, so they can't arrive on the one
+	// clock while we are being reset
+	always @(*)
+	if (o_reset)
+		`ASSUME(!i_stb);
+
+	// Every payload word starts with its top four bits, 7'b000_dddd
+	always @(*)
+	if ((f_bus)&&(f_nbytes == 3'd5))
+		`ASSUME(i_byte[6:4] == 3'b000);
+
+	// f_nbytes, f_nwords, f_cmd, f_word
+	// {{{
+	initial	f_nbytes = 0;
+	initial	f_nwords = 0;
+	always @(posedge i_clk)
+	if (o_reset)
+	begin
+		f_nbytes <= 0;
+		f_nwords <= 0;
+	end else if ((f_bus)&&(f_nbytes == 0))
+	begin
+		case(i_byte[6:4])
+		3'b101: begin	// Write (n+1) words
+			f_cmd    <= 2'b01;
+			f_nbytes <= 3'd5;
+			f_nwords <= i_byte[3:0];
+			end
+		3'b110: begin	// Set address, one word
+			f_cmd    <= 2'b10;
+			f_nbytes <= 3'd5;
+			f_nwords <= 0;
+			end
+		default: begin end	// Reads, resets, and ignored bytes
+		endcase
+	end else if (f_bus)
+	begin
+		f_nbytes <= f_nbytes - 1'b1;
+		if (f_nbytes == 3'd5)
+			f_word <= { 21'h0, i_byte[3:0] };
+		else
+			f_word <= { f_word[17:0], i_byte[6:0] };
+		if ((f_nbytes == 3'd1)&&(f_nwords != 0))
+		begin
+			f_nbytes <= 3'd5;
+			f_nwords <= f_nwords - 1'b1;
+		end
+	end
+	// }}}
+
+	// What each byte should produce on the next clock
+	// {{{
+	always @(*)
+	begin
+		f_expect_stb   = 1'b0;
+		f_expect_reset = 1'b0;
+		f_expect_word  = 34'h0;
+		if ((f_bus)&&(f_nbytes == 0))
+		begin
+			if (i_byte[6:4] == 3'b100)
+			begin
+				// Reads have no payload, and go out at once
+				f_expect_stb  = 1'b1;
+				f_expect_word = { 2'b00, 28'h0, i_byte[3:0] };
+			end
+			f_expect_reset = (i_byte[6:0] == 7'h7f);
+		end else if ((f_bus)&&(f_nbytes == 3'd1))
+		begin
+			// The last byte of a write or address payload
+			f_expect_stb  = 1'b1;
+			f_expect_word = { f_cmd, f_word, i_byte[6:0] };
+		end
+	end
+
+	always @(posedge i_clk)
+	if (f_past_valid)
+	begin
+		assert(o_reset == $past(f_expect_reset));
+		assert(o_stb   == $past(f_expect_stb));
+		if (o_stb)
+			assert(o_word == $past(f_expect_word));
+	end
+	// }}}
+
+	// Induction: the decoder must know where it is within each frame
+	// {{{
+	always @(*)
+	begin
+		assert(r_nbytes == f_nbytes);
+		if (f_nbytes != 0)
+		begin
+			assert(r_nwords == f_nwords);
+			assert(r_cmd    == f_cmd);
+		end
+		if ((f_nbytes != 0)&&(f_nbytes != 3'd5))
+			assert(r_word == f_word);
+	end
+	// }}}
+
+	// Cover an address, two writes, and then a read
+	// {{{
+	initial	f_seq = 0;
+	always @(posedge i_clk)
+	if (o_reset)
+		f_seq <= 0;
+	else if (o_stb)
+	case(f_seq)
+	3'h0: if (o_word[33:32] == 2'b10) f_seq <= 3'h1;
+	3'h1: if (o_word[33:32] == 2'b01) f_seq <= 3'h2;
+	3'h2: if (o_word[33:32] == 2'b01) f_seq <= 3'h3;
+	3'h3: if (o_word[33:32] == 2'b00) f_seq <= 3'h4;
+	default: begin end
+	endcase
+
+	always @(*)
+		cover(f_seq == 3'h4);
+	// }}}
+`endif
+// }}}
+endmodule
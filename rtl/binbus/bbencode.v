@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	bbencode.v
+// {{{
+// Project:	dbgbus, a collection of 8b channel to WB bus debugging protocols
+//
+// Purpose:	Encodes the 34-bit response words of the bus (hbexec, hbints,
+//		hbidle) into the 7-bit bytes of the binary framed debugging
+//	bus.  Each response starts with a byte, 7'b0tt_dddd:
+//
+//	7'b000_dddd	Read data.  Four more bytes follow.
+//	7'b001_dddd	Address.  Four more bytes follow.
+//	7'b010_nnnn	(n+1) write acknowledgements
+//	7'b011_0sss	Special: 0 reset, 1 bus error, 2 interrupt, 3 idle
+//
+//	The four bytes following data or an address carry the bottom 28-bits
+//	of the word, seven bits at a time, most significant first.  The dddd
+//	bits of the leading byte carry the top four.
+//
+//	The parallel port uses 8'hff to mean that nothing is being sent, so
+//	we must never send a 7'h7f on the bus channel.  Each seven bit group
+//	is therefore XOR'd with 7'h2a (so that neither all zeros nor all ones
+//	hits this value), and should the result be either 7'h7e or 7'h7f it is
+//	sent as 7'h7e followed by a byte containing the bottom bit.
+//
+//	Write acknowledgements are coalesced.  While the outgoing channel is
+//	busy, up to sixteen acknowledgements may be gathered into the same
+//	byte.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+// }}}
+// Copyright (C) 2021, Gisselquist Technology, LLC
+// {{{
+// This file is part of the hexbus debugging interface.
+//
+// The hexbus interface is free software (firmware): you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// The hexbus interface is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  (It's in the $(ROOT)/doc directory.  Run make
+// with no target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+// }}}
+// License:	LGPL, v3, as defined and found on www.gnu.org,
+// {{{
+//		http://www.gnu.org/licenses/lgpl.html
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+`default_nettype	none
+// }}}
+module	bbencode (
+		// {{{
+		input	wire		i_clk, i_reset,
+		//
+		input	wire		i_stb,
+		input	wire	[33:0]	i_word,
+		output	wire		o_busy,
+		//
+		output	reg		o_stb,
+		output	reg	[6:0]	o_byte,
+		input	wire		i_busy
+		// }}}
+	);
+
+	// Local declarations
+	// {{{
+	localparam [6:0]	SCRAMBLE = 7'h2a,
+				ESCAPE   = 7'h7e;
+	wire		w_free, w_ack, w_newack, w_flush, w_word;
+	wire	[6:0]	w_chunk;
+	reg	[2:0]	r_len;
+	reg	[27:0]	r_word;
+	reg		r_esc, r_escbit;
+	reg	[4:0]	r_acks;
+	// }}}
+
+	// w_free is true if the output register may be loaded on this clock
+	assign	w_free  = (!o_stb)||(!i_busy);
+	assign	w_ack   = (i_word[33:32] == 2'b01);
+	assign	w_chunk = r_word[27:21] ^ SCRAMBLE;
+
+	// Acknowledgements may be accepted at any time, so long as our counter
+	// hasn't overflowed.  Everything else must wait until all that came
+	// before it has been sent.
+	assign	o_busy = (w_ack) ? r_acks[4]
+			: ((!w_free)||(r_esc)||(r_len != 0)||(r_acks != 0));
+
+	assign	w_newack = (i_stb)&&(w_ack)&&(!r_acks[4]);
+	assign	w_flush  = (w_free)&&(!r_esc)&&(r_len == 0)&&(r_acks != 0);
+	assign	w_word   = (i_stb)&&(!w_ack)&&(!o_busy);
+
+	// r_acks
+	// {{{
+	initial	r_acks = 0;
+	always @(posedge i_clk)
+	if (i_reset)
+		r_acks <= 0;
+	else if (w_flush)
+		r_acks <= (w_newack) ? 5'h1 : 5'h0;
+	else if (w_newack)
+		r_acks <= r_acks + 1'b1;
+	// }}}
+
+	// r_len, r_word, r_esc, r_escbit
+	// {{{
+	initial	r_len = 0;
+	initial	r_esc = 1'b0;
+	always @(posedge i_clk)
+	if (i_reset)
+	begin
+		r_len <= 0;
+		r_esc <= 1'b0;
+	end else if (w_free)
+	begin
+		if (r_esc)
+			r_esc <= 1'b0;
+		else if (r_len != 0)
+		begin
+			r_len  <= r_len - 1'b1;
+			r_word <= { r_word[20:0], 7'h0 };
+			r_esc  <= (w_chunk[6:1] == ESCAPE[6:1]);
+			r_escbit <= w_chunk[0];
+		end else if (w_word)
+		begin
+			r_word <= i_word[27:0];
+			r_len  <= (i_word[33:32] != 2'b11) ? 3'd4 : 3'd0;
+		end
+	end
+	// }}}
+
+	// o_stb, o_byte
+	// {{{
+	initial	o_stb = 1'b0;
+	always @(posedge i_clk)
+	if (i_reset)
+		o_stb <= 1'b0;
+	else if (w_free)
+		o_stb <= (r_esc)||(r_len != 0)||(r_acks != 0)||(w_word);
+
+	always @(posedge i_clk)
+	if (w_free)
+	begin
+		if (r_esc)
+			o_byte <= { 6'h0, r_escbit };
+		else if (r_len != 0)
+			o_byte <= (w_chunk[6:1] == ESCAPE[6:1]) ? ESCAPE : w_chunk;
+		else if (r_acks != 0)
+			o_byte <= { 3'b010, r_acks[3:0] - 1'b1 };
+		else if (i_word[33:32] == 2'b11)
+			// Specials: reset, bus error, interrupt, or idle
+			o_byte <= { 3'b011, 1'b0, i_word[31:29] };
+		else
+			// Read data or a new address
+			o_byte <= { 2'b00, i_word[33], i_word[31:28] };
+	end
+	// }}}
+endmodule
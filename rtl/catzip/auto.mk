@@ -46,12 +46,16 @@ ZIPCPU  := $(addprefix $(ZIPCPUD)/,zipcpu.v cpuops.v dblfetch.v prefetch.v memop
 GPIO := wbgpio.v
 
 HBBUSD := ../hexbus
-HBBUS  := $(addprefix $(HBBUSD)/,hbconsole.v hbdechex.v hbdeword.v hbexec.v hbgenhex.v hbidle.v hbints.v hbnewline.v hbpack.v console.v)
+HBBUS  := $(addprefix $(HBBUSD)/,hbconsole.v hbdechex.v hbdeword.v hbexec.v hbfifo.v hbgenhex.v hbidle.v hbints.v hbnewline.v hbpack.v console.v)
+BBBUSD := ../binbus
+BBBUS  := $(addprefix $(BBBUSD)/,bbconsole.v bbdecode.v bbburst.v bbencode.v)
+WBUBUSD := wbubus
+WBUBUS  := $(addprefix $(WBUBUSD)/,wbuconsole.v wbuinput.v wbutohex.v wbureadcw.v wbudecompress.v wbufifo.v wbuexec.v wbuoutput.v wbuidleint.v wbucompress.v wbudeword.v wbucompactlines.v wbusixchar.v)
 PPORTD := ../pport
 PPORT  := $(addprefix $(PPORTD)/,ppio.v pport.v ufifo.v)
 BKRAM := memdev.v
 
 BUSPICD := cpu
 BUSPIC  := $(addprefix $(BUSPICD)/,icontrol.v)
-VFLIST := main.v  $(SDRAM) $(ZIPCPU) $(GPIO) $(HBBUS) $(PPORT) $(BKRAM) $(BUSPIC)
-AUTOVDIRS :=  -y cpu -y ../hexbus -y ../pport
+VFLIST := main.v  $(SDRAM) $(ZIPCPU) $(GPIO) $(HBBUS) $(BBBUS) $(WBUBUS) $(PPORT) $(BKRAM) $(BUSPIC)
+AUTOVDIRS :=  -y cpu -y ../hexbus -y ../binbus -y wbubus -y ../pport
@@ -84,6 +84,11 @@ module	main(i_clk, i_reset,
 		o_ram_cs_n, o_ram_cke, o_ram_ras_n, o_ram_cas_n, o_ram_we_n, 
 			o_ram_bs, o_ram_addr,
 			o_ram_drive_data, i_ram_data, o_ram_data, o_ram_dqm,
+`ifdef	SDRAM_FASTSIM
+		o_sdram_cyc, o_sdram_stb, o_sdram_we, o_sdram_addr,
+			o_sdram_data, o_sdram_sel,
+			i_sdram_stall, i_sdram_ack, i_sdram_data,
+`endif
 			o_debug,
 		// GPIO ports
 		i_gpio, o_gpio,
@@ -140,6 +145,16 @@ parameter	RDLY = 6;
  
 	wire	[15:0]	ram_data;
 	output	wire		o_ram_drive_data; 
+`ifdef	SDRAM_FASTSIM
+	// With SDRAM_FASTSIM, the simulator answers the SDRAM's bus requests
+	// itself, from a zero wait state memory model
+	output	wire		o_sdram_cyc, o_sdram_stb, o_sdram_we;
+	output	wire	[(24-3):0]	o_sdram_addr;
+	output	wire	[31:0]	o_sdram_data;
+	output	wire	[3:0]	o_sdram_sel;
+	input	wire		i_sdram_stall, i_sdram_ack;
+	input	wire	[31:0]	i_sdram_data;
+`endif
 	
 	localparam	NGPI = 2, NGPO=11;
 	// GPIO ports
@@ -773,6 +788,33 @@ parameter	RDLY = 6;
 	// zero if the component is not included.
 	//
 `ifdef	SDRAM_ACCESS
+`ifdef	SDRAM_FASTSIM
+	//
+	// Verilator only: hand the bus straight to the simulator's memory
+	// model, and leave the SDRAM controller out altogether
+	assign	o_sdram_cyc  = wb_sdram_cyc;
+	assign	o_sdram_stb  = wb_sdram_stb;
+	assign	o_sdram_we   = wb_sdram_we;
+	assign	o_sdram_addr = wb_sdram_addr[(24-3):0];
+	assign	o_sdram_data = wb_sdram_data;
+	assign	o_sdram_sel  = wb_sdram_sel;
+	assign	wb_sdram_stall = i_sdram_stall;
+	assign	wb_sdram_ack   = i_sdram_ack;
+	assign	wb_sdram_idata = i_sdram_data;
+
+	// The SDRAM itself sits idle
+	assign	o_ram_cs_n  = 1'b1;
+	assign	o_ram_cke   = 1'b0;
+	assign	o_ram_ras_n = 1'b1;
+	assign	o_ram_cas_n = 1'b1;
+	assign	o_ram_we_n  = 1'b1;
+	assign	o_ram_bs    = 2'b00;
+	assign	o_ram_addr  = 12'h0;
+	assign	o_ram_drive_data = 1'b0;
+	assign	o_ram_data  = 16'h0;
+	assign	o_ram_dqm   = 2'b11;
+	assign	o_debug     = 32'h0;
+`else
 	wbsdram 
 	
 		sdrami(i_clk,
@@ -791,6 +833,7 @@ parameter	RDLY = 6;
 		o_ram_bs, o_ram_addr,
 		o_ram_drive_data, i_ram_data, o_ram_data, o_ram_dqm,
 		o_debug);	
+`endif	// SDRAM_FASTSIM
 
 `else	// SDRAM_ACCESS
 
@@ -897,8 +940,9 @@ parameter	RDLY = 6;
 `endif	// GPIO_ACCESS
 
 `ifdef	WBUBUS_MASTER
-	// Parallel port logic
-	pport
+	// Parallel port logic.  The transmit FIFO lets the host burst many
+	// bytes at a time at us, collecting the responses only afterwards.
+	pport #(.LGTXFIFO(9))
 	hbi_pp(
 		// {{{
 		i_clk,
@@ -915,7 +959,29 @@ parameter	RDLY = 6;
 	// Verilator lint_off UNUSED
 	wire	[29:0]	hb_tmp_addr;
 	// Verilator lint_on  UNUSED
+`ifdef	WBU_MASTER
+	// The compressing wbubus, in place of the hexbus.  This produces a full
+	// 32-bit word address, and has no byte select lines.
+	// Verilator lint_off UNUSED
+	wire	[31:0]	hb_wbu_addr;
+	// Verilator lint_on  UNUSED
+	wbuconsole genbus(i_clk, pp_rx_stb, pp_rx_data,
+			hb_hb_cyc, hb_hb_stb, hb_hb_we, hb_wbu_addr, hb_hb_data,
+			hb_hb_stall, hb_hb_ack, hb_hb_idata, hb_hb_err,
+			w_bus_int,
+			pp_tx_stb, pp_tx_data, pp_tx_busy,
+			//
+			w_console_tx_stb, w_console_tx_data, w_console_busy,
+			w_console_rx_stb, w_console_rx_data);
+	assign	hb_hb_sel = 4'hf;
+	assign	hb_tmp_addr = hb_wbu_addr[29:0];
+`else
+`ifdef	BINBUS_MASTER
+	// The binary framed debugging bus, in place of the hexbus
+	bbconsole genbus(i_clk, pp_rx_stb, pp_rx_data,
+`else
 	hbconsole genbus(i_clk, pp_rx_stb, pp_rx_data,
+`endif
 			hb_hb_cyc, hb_hb_stb, hb_hb_we, hb_tmp_addr, hb_hb_data, hb_hb_sel,
 			hb_hb_stall, hb_hb_ack, hb_hb_err, hb_hb_idata,
 			w_bus_int,
@@ -923,6 +989,7 @@ parameter	RDLY = 6;
 			//
 			w_console_tx_stb, w_console_tx_data, w_console_busy,
 			w_console_rx_stb, w_console_rx_data);
+`endif
 	assign	hb_hb_addr= hb_tmp_addr[(25-1):0];
 `else	// WBUBUS_MASTER
 `endif	// WBUBUS_MASTER
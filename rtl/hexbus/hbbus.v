@@ -71,6 +71,8 @@ module	hbbus #(
 	wire	[4:0]	dec_bits;
 	wire		iw_stb;
 	wire	[33:0]	iw_word;
+	wire		cmd_stb, wb_busy;
+	wire	[33:0]	cmd_word;
 	wire		ow_stb;
 	wire	[33:0]	ow_word;
 	wire		idl_busy, int_stb;
@@ -81,9 +83,9 @@ module	hbbus #(
 	wire	[4:0]	hb_bits;
 	wire		hx_stb, nl_busy;
 	wire	[6:0]	hx_byte;
-	// verilator lint_off UNUSED
-	wire		wb_busy;
 	wire		int_busy;
+	// verilator lint_off UNUSED
+	wire		iw_busy;
 	// verilator lint_on UNUSED
 	// }}}
 
@@ -102,11 +104,17 @@ module	hbbus #(
 	hbpack	packxi(i_clk, w_reset,
 		dec_stb, dec_bits, iw_stb, iw_word);
 
+	// Queue up these command words, so that the host may send several
+	// commands without waiting for each to complete
+	hbfifo	cmdfifo(i_clk, w_reset,
+			iw_stb, iw_word, iw_busy,
+			cmd_stb, cmd_word, wb_busy);
+
 	//
 	// We'll use these bus command words to drive a wishbone bus
 	//
-	hbexec	#(AW) wbexec(i_clk, w_reset, iw_stb, iw_word, wb_busy,
-			ow_stb, ow_word,
+	hbexec	#(AW) wbexec(i_clk, w_reset, cmd_stb, cmd_word, wb_busy,
+			ow_stb, ow_word, int_busy,
 			o_wb_cyc, o_wb_stb, o_wb_we, o_wb_addr, o_wb_data,
 				o_wb_sel, i_wb_ack, i_wb_stall, i_wb_err,
 				i_wb_data);
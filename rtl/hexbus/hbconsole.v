@@ -80,13 +80,13 @@ module	hbconsole (
 	wire		iw_stb;
 	wire	[33:0]	iw_word;
 	// verilator lint_off UNUSED
-	wire		wb_busy;
+	wire		iw_busy;
 	// verilator lint_on UNUSED
+	wire		cmd_stb, wb_busy;
+	wire	[33:0]	cmd_word;
 	wire		ow_stb;
 	wire	[33:0]	ow_word;
-	// verilator lint_off UNUSED
 	wire		int_busy;
-	// verilator lint_on UNUSED
 	wire		idl_busy, int_stb;
 	wire	[33:0]	int_word;
 	wire		hb_busy, idl_stb;
@@ -133,14 +133,25 @@ module	hbconsole (
 	);
 
 
+	// Queue up these command words, so that the host may send several
+	// commands without waiting for each to complete
+	hbfifo
+	cmdfifo(
+		// {{{
+		i_clk, w_reset,
+		iw_stb, iw_word, iw_busy,
+		cmd_stb, cmd_word, wb_busy
+		// }}}
+	);
+
 	//
 	// We'll use these bus command words to drive a wishbone bus
 	//
 	hbexec
 	wbexec(
 		// {{{
-		i_clk, w_reset, iw_stb, iw_word, wb_busy,
-		ow_stb, ow_word,
+		i_clk, w_reset, cmd_stb, cmd_word, wb_busy,
+		ow_stb, ow_word, int_busy,
 		o_wb_cyc, o_wb_stb, o_wb_we, o_wb_addr, o_wb_data,
 			o_wb_sel, i_wb_stall, i_wb_ack, i_wb_err,
 			i_wb_data
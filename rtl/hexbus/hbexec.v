@@ -12,14 +12,18 @@
 //	2'b01	Write (lower 32-bits are the value to be written)
 //	2'b10	Set address
 //		Next 30 bits are the address
-//		bit[1] is an address difference bit
+//		bit[1] is an address difference bit.  When set, the
+//			(sign extended) value is added to the current address
 //		bit[0] is an increment bit
 //	2'b11	Special command
 //
 //	In the interests of code simplicity, this memory operator is 
 //	susceptible to unknown results should a new command be sent to it
 //	before it completes the last one.  Unpredictable results might then
-//	occurr.
+//	occurr.  o_cmd_busy will be true from the time a command is accepted
+//	until its response has been accepted by the return channel (i.e.
+//	i_rsp_busy is clear).  Placing a FIFO (hbfifo) in front of this
+//	module therefore allows a host to pipeline its requests.
 //
 // Creator:	Dan Gisselquist, Ph.D.
 //		Gisselquist Technology, LLC
@@ -88,6 +92,7 @@ module	hbexec #(
 		// {{{
 		output	reg			o_rsp_stb,
 		output	reg	[(CW-1):0]	o_rsp_word,
+		input	wire			i_rsp_busy,
 		// }}}
 		// Wishbone outputs
 		// {{{
@@ -164,7 +169,7 @@ module	hbexec #(
 		//
 		// IDLE state
 		//
-		if (i_cmd_bus)
+		if ((i_cmd_bus)&&(!o_cmd_busy))
 		begin
 			// We've been asked to start a bus cycle from our
 			// command word, either RD or WR
@@ -174,12 +179,19 @@ module	hbexec #(
 	end
 	// }}}
 
-	// For now, we'll use the bus cycle line as an indication of whether
-	// or not we are too busy to accept anything else from the command
-	// port.  This will change if we want to accept multiple write
-	// commands per bus cycle, but that will be a bus master that's
-	// not nearly so simple.
-	assign	o_cmd_busy = o_wb_cyc;
+	// o_cmd_busy
+	// {{{
+	// We use the bus cycle line as an indication of whether or not we
+	// are too busy to accept anything else from the command port.  This
+	// will change if we want to accept multiple write commands per bus
+	// cycle, but that will be a bus master that's not nearly so simple.
+	//
+	// Since o_rsp_stb has no backpressure of its own, we also stay busy
+	// from the time any response is generated (newaddr, o_rsp_stb) until
+	// the return channel has accepted it.  Otherwise a second response
+	// might overwrite the first one before it was ever sent.
+	assign	o_cmd_busy = (o_wb_cyc)||(newaddr)||(o_rsp_stb)||(i_rsp_busy);
+	// }}}
 
 
 	//
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename: 	hbfifo.v
+// {{{
+// Project:	dbgbus, a collection of 8b channel to WB bus debugging protocols
+//
+// Purpose:	A small synchronous FIFO to sit between the command packer
+//		(hbpack) and the bus executive (hbexec).  Without it, any
+//	command arriving while hbexec is busy is simply dropped, forcing the
+//	host to wait for every response before issuing the next command.  With
+//	it, the host may issue up to (1<<LGFLEN) commands before it needs to
+//	wait for any responses.
+//
+//	The handshake follows that of hbbuffer: i_stb/o_busy on the input,
+//	o_stb/i_busy on the output.  Commands presented while o_busy is true
+//	are lost, so the host is responsible for limiting how many commands
+//	it has outstanding at any given time.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+// }}}
+// Copyright (C) 2018-2021, Gisselquist Technology, LLC
+// {{{
+// This file is part of the hexbus debugging interface.
+//
+// The hexbus interface is free software (firmware): you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public License
+// as published by the Free Software Foundation, either version 3 of the
+// License, or (at your option) any later version.
+//
+// The hexbus interface is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  (It's in the $(ROOT)/doc directory.  Run make
+// with no target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+// }}}
+// License:	LGPL, v3, as defined and found on www.gnu.org,
+// {{{
+//		http://www.gnu.org/licenses/lgpl.html
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+`default_nettype	none
+// }}}
+module	hbfifo #(
+		// {{{
+		parameter	W=34,
+		parameter	LGFLEN=4,
+		localparam	FLEN=(1<<LGFLEN)
+		// }}}
+	) (
+		// {{{
+		input	wire		i_clk, i_reset,
+		//
+		input	wire		i_stb,
+		input	wire	[W-1:0]	i_word,
+		output	wire		o_busy,
+		//
+		output	reg		o_stb,
+		output	reg	[W-1:0]	o_word,
+		input	wire		i_busy
+		// }}}
+	);
+
+	// Local declarations
+	// {{{
+	reg	[W-1:0]		mem	[0:FLEN-1];
+	reg	[LGFLEN:0]	wr_addr, rd_addr;
+	wire	[LGFLEN:0]	fill;
+	wire			w_wr, w_rd;
+	// }}}
+
+	assign	fill   = wr_addr - rd_addr;
+	assign	o_busy = fill[LGFLEN];
+	assign	w_wr   = (i_stb)&&(!o_busy);
+	assign	w_rd   = (fill != 0)&&((!o_stb)||(!i_busy));
+
+	// Write side
+	// {{{
+	initial	wr_addr = 0;
+	always @(posedge i_clk)
+	if (i_reset)
+		wr_addr <= 0;
+	else if (w_wr)
+		wr_addr <= wr_addr + 1'b1;
+
+	always @(posedge i_clk)
+	if (w_wr)
+		mem[wr_addr[LGFLEN-1:0]] <= i_word;
+	// }}}
+
+	// Read side
+	// {{{
+	// The output is registered, so that the memory may be placed into
+	// block RAM.  This also adds one more word of storage to the FIFO.
+	initial	rd_addr = 0;
+	always @(posedge i_clk)
+	if (i_reset)
+		rd_addr <= 0;
+	else if (w_rd)
+		rd_addr <= rd_addr + 1'b1;
+
+	always @(posedge i_clk)
+	if (w_rd)
+		o_word <= mem[rd_addr[LGFLEN-1:0]];
+
+	initial	o_stb = 1'b0;
+	always @(posedge i_clk)
+	if (i_reset)
+		o_stb <= 1'b0;
+	else if ((!o_stb)||(!i_busy))
+		o_stb <= (fill != 0);
+	// }}}
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+//
+// Formal properties
+// {{{
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+`ifdef	FORMAL
+`ifdef	HBFIFO
+`define	ASSUME	assume
+`define	ASSERT	assert
+`else
+`define	ASSUME	assert
+`define	ASSERT	assert
+`endif
+
+	reg	f_past_valid;
+	initial	f_past_valid = 1'b0;
+	always @(posedge i_clk)
+		f_past_valid <= 1'b1;
+
+	always @(posedge i_clk)
+	if ((!f_past_valid)||($past(i_reset)))
+	begin
+		`ASSERT(fill == 0);
+		`ASSERT(!o_stb);
+	end
+
+	always @(*)
+		`ASSERT(fill <= FLEN);
+
+	always @(posedge i_clk)
+	if ((f_past_valid)&&(!$past(i_reset)))
+	begin
+		// The output may not change while the next stage is busy
+		if (($past(o_stb))&&($past(i_busy)))
+			`ASSERT((o_stb)&&($stable(o_word)));
+
+		// Nothing leaves the FIFO unless something was in it
+		if (!$past(o_stb)&&($past(fill) == 0))
+			`ASSERT(!o_stb);
+	end
+
+	always @(posedge i_clk)
+		cover((f_past_valid)&&(o_busy));
+`endif
+// }}}
+endmodule
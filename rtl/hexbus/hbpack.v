@@ -20,7 +20,12 @@
 //		  Payload is the value to be written
 //
 //	5'h12	Address, top 2-bits set to 2'b10
-//		  Payload is the new address to go to
+//		  Payload is the new address to go to.  Unlike the other
+//		  payloads, the first hex digit of an address payload is sign
+//		  extended.  This allows short negative address differences
+//		  (bit[1] set) to be sent with only a few digits.  Positive
+//		  values of fewer than eight digits whose first digit is 8-f
+//		  must therefore be sent with a leading zero.
 //
 //	5'h13	Special, top 2-bits set to 2'b11
 //
@@ -71,7 +76,7 @@ module	hbpack (
 
 	// Local declarations
 	// {{{
-	reg		cmd_loaded;
+	reg		cmd_loaded, first_digit;
 	reg	[33:0]	r_word;
 	// }}}
 
@@ -94,6 +99,18 @@ module	hbpack (
 		o_pck_stb <= (!i_reset)&&((i_stb)&&(cmd_loaded)&&(i_bits[4]));
 	// }}}
 
+	// first_digit
+	// {{{
+	// True if the next hex digit will be the first one following a
+	// command character
+	initial	first_digit = 1'b0;
+	always @(posedge i_clk)
+	if (i_reset)
+		first_digit <= 1'b0;
+	else if (i_stb)
+		first_digit <= i_bits[4];
+	// }}}
+
 	// r_word
 	// {{{
 	initial	r_word = 0;
@@ -108,7 +125,10 @@ module	hbpack (
 			r_word[33:32] <= i_bits[1:0];
 			// Clear our buffer on any new command
 			r_word[31:0] <= 0;
-		end else
+		end else if ((first_digit)&&(r_word[33:32] == 2'b10))
+			// The first digit of an address is sign extended
+			r_word[31:0] <= { {(28){i_bits[3]}}, i_bits[3:0] };
+		else
 			// Other wise, new hex digits just get
 			// placed in the bottom of our shift register,
 			// and everything quietly moves over by one
@@ -160,6 +180,13 @@ module	hbpack (
 	if ((f_past_valid)&&(!$past(i_reset))
 				&&($past(i_stb))&&($past(i_bits[4:2])==3'b100))
 		`ASSERT(cmd_loaded);
+
+	always @(posedge i_clk)
+	if ((f_past_valid)&&(!$past(i_reset))&&($past(i_stb))
+			&&(!$past(i_bits[4]))&&($past(first_digit))
+			&&($past(r_word[33:32]) == 2'b10))
+		`ASSERT(r_word[31:0] == { {(28){$past(i_bits[3])}},
+						$past(i_bits[3:0]) });
 `endif
 // }}}
 endmodule
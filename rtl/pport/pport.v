@@ -50,6 +50,13 @@ module	pport(i_clk,
 		i_tx_wr, i_tx_data, o_tx_busy,
 		i_pp_dir, i_pp_clk, i_pp_data, o_pp_data,
 			o_pp_clkfb, o_dbg);
+	// If LGTXFIFO is non-zero, bytes to transmit are first queued in a
+	// FIFO of (1<<LGTXFIFO) bytes.  This allows the host to burst many
+	// bytes at us without reading anything back between them, while the
+	// responses to those bytes pile up here rather than stalling whatever
+	// is producing them.  The formal properties below only cover the
+	// default, LGTXFIFO = 0, configuration.
+	parameter	LGTXFIFO = 0;
 	input	wire	i_clk;
 	// Receive interface
 	output	reg		o_rx_stb;
@@ -57,7 +64,7 @@ module	pport(i_clk,
 	// Transmit interface
 	input	wire		i_tx_wr;
 	input	wire	[7:0]	i_tx_data;
-	output	reg		o_tx_busy;
+	output	wire		o_tx_busy;
 	// Parallel port interface itself
 	input	wire		i_pp_dir;
 	input	wire		i_pp_clk;
@@ -118,22 +125,61 @@ module	pport(i_clk,
 		if (pp_stb)
 			o_rx_data <= ck_pp_data;
 
+	wire		tx_wr;
+	wire	[7:0]	tx_data;
+	reg		tx_busy;
+
+	generate if (LGTXFIFO > 0)
+	begin : TXFIFO
+		// {{{
+		wire		txf_empty_n, txf_err;
+		wire	[15:0]	txf_status;
+		reg	[LGTXFIFO:0]	txf_fill;
+
+		ufifo	#(.LGFLEN(LGTXFIFO), .BW(8), .RXFIFO(1))
+		txfifo(i_clk, 1'b0,
+			(i_tx_wr)&&(!o_tx_busy), i_tx_data,
+			txf_empty_n,
+			tx_wr, tx_data,
+			txf_status, txf_err);
+
+		// Keep our own count of what's in the FIFO, so as to never
+		// accept more than it can hold
+		initial	txf_fill = 0;
+		always @(posedge i_clk)
+		case({ (i_tx_wr)&&(!o_tx_busy), tx_wr })
+		2'b10:	txf_fill <= txf_fill + 1'b1;
+		2'b01:	txf_fill <= txf_fill - 1'b1;
+		default: begin end
+		endcase
+
+		assign	tx_wr = (txf_empty_n)&&(!tx_busy);
+		assign	o_tx_busy = (txf_fill >= (1<<LGTXFIFO)-2);
+		// }}}
+	end else begin : NO_TXFIFO
+		// {{{
+		assign	tx_wr     = i_tx_wr;
+		assign	tx_data   = i_tx_data;
+		assign	o_tx_busy = tx_busy;
+		// }}}
+	end endgenerate
+
 	reg	loaded;
 	initial	loaded = 1'b0;
 	always @(posedge i_clk)
-		if ((i_tx_wr)&&(!o_tx_busy))
+		if ((tx_wr)&&(!tx_busy))
 			loaded <= 1'b1;
 		else if ((pp_stb)&&(stb_wr_dir))
 			loaded <= 1'b0;
 
-	initial	o_tx_busy = 1'b0;
+	initial	tx_busy = 1'b0;
 	always @(posedge i_clk)
 		// We are busy if ...
 		//	1. We have a word loaded and ready to transmit
-		o_tx_busy <= (loaded)
+		tx_busy <= (loaded)
 			// 2. We are not busy, and someone gives us a word
 			// to transmit, or
-			||((i_tx_wr)&&(!o_tx_busy))
+			||((tx_wr)&&(!tx_busy))
 			// 3. We are in the middle of a read transaction.
 			// During transactions, things cannot be changed, so
 			// ... we are hence busy
@@ -142,17 +188,17 @@ module	pport(i_clk,
 
 	initial	o_pp_data = 8'hff;
 	always @(posedge i_clk)
-	if (!o_tx_busy)
+	if (!tx_busy)
 	begin
-		if (i_tx_wr)
-			o_pp_data <= i_tx_data[7:0];
+		if (tx_wr)
+			o_pp_data <= tx_data;
 		else
 			o_pp_data <= 8'hff;
 	end
 
 reg	r_dbg;
 always @(posedge i_clk)
-	r_dbg <= (i_tx_wr)&&(!o_tx_busy);
+	r_dbg <= (tx_wr)&&(!tx_busy);
 assign	o_dbg = r_dbg; // (o_rx_stb);
 `ifdef	FORMAL
 	reg	f_past_valid_gbl, f_past_valid;
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	asynclog.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Logs the traffic passing through a bridge, such as netpport
+//		or the simulator's PPORTSIM, without slowing that traffic
+//	down.  Rather than printing each line as it goes by, the line is
+//	copied into a lock-free ring, and a background thread formats and
+//	writes it out.  Lines beyond ALOG_MAXRATE per second are dropped and
+//	counted, as are lines for which there's no room in the ring.
+//
+//	Every line is also counted against its channel, as are the bytes
+//	passing through it, whether or not the line is logged.  Hence, with
+//	the level set to ALOG_INFO, the traffic can still be measured without
+//	paying for any of its text.
+//
+//	Once signals() has been called, SIGUSR1 switches the logging of
+//	traffic on and off, and SIGUSR2 writes out the counters.
+//
+//	Only one thread may log to any one ASYNCLOG.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	ASYNCLOG_H
+#define	ASYNCLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <atomic>
+
+#include "ringbuf.h"
+
+// Logging levels.  Nothing at a level above the current one is logged.
+#define	ALOG_NONE	0	// Log nothing at all
+#define	ALOG_ERR	1	// Errors only
+#define	ALOG_INFO	2	// Connections coming and going
+#define	ALOG_DATA	3	// Every line of traffic
+
+#define	ALOG_MAXRATE	1000	// Lines of traffic per second
+#define	ALOG_MAXCHAN	8
+#define	ALOG_LINELN	512
+#define	ALOG_RINGSZ	(1<<18)
+
+class	ASYNCLOG {
+	FILE	*m_fp;
+	RINGBUF	m_ring;
+	pthread_t	m_writer;
+	std::atomic<int>	m_level;
+	std::atomic<bool>	m_done, m_report, m_flush;
+
+	// Per channel counters
+	int		m_nchan;
+	const char	*m_chname[ALOG_MAXCHAN];
+	std::atomic<unsigned long>	m_bytes[ALOG_MAXCHAN],
+				m_lines[ALOG_MAXCHAN];
+	std::atomic<unsigned long>	m_dropped;
+
+	// The rate limit, as a bucket of tokens, one per line
+	unsigned	m_maxrate;
+	double		m_tokens, m_last;
+
+	void	put(int lvl, const char *prefix, const char *text,
+			unsigned len);
+	bool	drain(void);
+	void	write_counters(void);
+	static	void	*writer(void *);
+	static	void	handler(int sig);
+public:
+	// Log to fname, or to stdout if fname is NULL
+	ASYNCLOG(const char *fname = NULL, int level = ALOG_DATA,
+			unsigned maxrate = ALOG_MAXRATE);
+	~ASYNCLOG(void);
+
+	// Get or set the logging level, at any time
+	int	level(void) const { return m_level.load(); }
+	void	level(int lvl);
+
+	// Name a new channel, returning its number for count() and line()
+	int	channel(const char *name);
+
+	// Count nbytes of traffic against chan
+	void	count(int chan, unsigned nbytes) {
+		m_bytes[chan].store(m_bytes[chan].load(
+			std::memory_order_relaxed) + nbytes,
+			std::memory_order_relaxed);
+	}
+
+	// Count, and log at ALOG_DATA, one line of traffic.  A trailing
+	// newline, if present, is dropped.
+	void	line(int chan, const char *prefix, const char *text,
+			unsigned len);
+
+	// Log a message, printf() style
+	void	printf(int lvl, const char *fmt, ...)
+		__attribute__((format(printf, 3, 4)));
+
+	// Have the writer write out the counters as soon as it can
+	void	report(void) { m_report = true; }
+
+	// Wait until everything logged so far has been written out, as when
+	// about to exit()
+	void	flush(void);
+
+	// Let SIGUSR1 and SIGUSR2 control this log
+	static	void	signals(ASYNCLOG *log);
+};
+
+#endif
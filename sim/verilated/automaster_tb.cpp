@@ -43,6 +43,8 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <limits.h>
 
 #include "verilated.h"
 #include "Vmain.h"
@@ -62,26 +64,131 @@ void	usage(void) {
 	fprintf(stderr, "USAGE: main_tb <options> [zipcpu-elf-file]\n");
 	fprintf(stderr,
 // -h
-// -p # command port
-// -s # serial port
-// -f # profile file
+"\t-b\tBenchmark: report how many clock ticks per second the\n"
+"\t\tsimulation ran at\n"
+"\t-c <ticks>\n"
+"\t\tCheckpoint the simulation once it has run this many clock\n"
+"\t\tticks.  The CPU may also ask for a checkpoint, at any time,\n"
+"\t\twith a SIM 0x500 (or NSIM 0x500) instruction.\n"
 "\t-d\tSets the debugging flag\n"
+"\t-f\tProfile the CPU, writing the profile to pfile.bin, for zipprof\n"
+"\t\t(in sw/host) to read\n"
+"\t-i <ticks>\n"
+"\t\tWrite the performance counters out every this many clock\n"
+"\t\tticks, rather than every %lu.  Zero writes them only at the end.\n"
+"\t-l <levels>\n"
+"\t\tTrace only this many levels of the design's hierarchy\n"
+"\t-j <threads>\n"
+"\t\tRun the model Verilated for this many threads, built by\n"
+"\t\t\"make VTHREADS=<threads>\", rather than this one.  Zero\n"
+"\t\tselects the single-threaded model.\n"
+"\t-m <filename>\n"
+"\t\tKeep performance counters, for both the simulator and the\n"
+"\t\tdesign, writing them to <filename> as JSON, one line at a time\n"
+"\t-p <pc>[:<ticks>]\n"
+"\t\tStart tracing once the CPU first reaches this PC, and then\n"
+"\t\tfor this many clock ticks (or to the end, if not given)\n"
+"\t-r <checkpoint>\n"
+"\t\tRestore, and continue, the simulation from this checkpoint,\n"
+"\t\trather than starting from reset\n"
+"\t-s <checkpoint>\n"
+"\t\tThe file to save checkpoints to, main.ckpt by default\n"
+"\t-q\tQuiet: count, but don't log, the traffic through the parallel\n"
+"\t\tport.  SIGUSR1 turns the logging back on (or off again), and\n"
+"\t\tSIGUSR2 logs the counts.\n"
 "\t-t <filename>\n"
 "\t\tTurns on tracing, sends the trace to <filename>--assumed to\n"
-"\t\tbe a vcd file\n"
-);
+"\t\tbe a vcd file, or an fst file if built with \"make TRACE=fst\"\n"
+"\t-w <start>[:<ticks>]\n"
+"\t\tOnly trace from clock tick <start>, and then for this many\n"
+"\t\tticks (or to the end, if not given).  Either way, the CPU\n"
+"\t\tcan also start the trace with SIM 0x501, and stop it with\n"
+"\t\tSIM 0x502.\n"
+"\t-x\tWatch the wb bus crossbar, and print out each master's and\n"
+"\t\tslave's latency histogram, stalls, and bandwidth at the end\n",
+		PERF_INTERVAL);
+}
+
+/*
+ * runthreads
+ *
+ * The number of threads a Verilated model uses is fixed when it is Verilated,
+ * so each thread count is its own build: $(ARCH)-main_tb for the single
+ * threaded model, and $(ARCH)-main_tb-mt<N> for N threads.  To run with
+ * some other thread count, then, run that build in our place, with the same
+ * arguments.
+ */
+void	runthreads(char **argv, int nthreads) {
+	char	*exe, *mt;
+	size_t	ln;
+
+	if (nthreads < 0) {
+		fprintf(stderr, "ERR: Invalid thread count, %d\n", nthreads);
+		exit(EXIT_FAILURE);
+	}
+
+	ln = strlen(argv[0]);
+	exe = new char[ln + 16];
+	strcpy(exe, argv[0]);
+
+	// Strip any thread count from our own name, then add the new one
+	mt = strrchr(exe, '-');
+	if (mt && strncmp(mt, "-mt", 3) == 0 && mt[3]
+			&& strspn(&mt[3], "0123456789") == strlen(&mt[3]))
+		*mt = '\0';
+	if (nthreads > 0)
+		sprintf(&exe[strlen(exe)], "-mt%d", nthreads);
+
+	execvp(exe, argv);
+
+	fprintf(stderr, "ERR: Could not run %s\n", exe);
+	perror("O/S Err:");
+	fprintf(stderr, "Build it with \"make VTHREADS=%d\", in both "
+		"rtl/catzip and sim/verilated\n", nthreads);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * interrupt
+ *
+ * SIGINT and SIGTERM only ask the simulation to stop, between clock ticks,
+ * so that it can close its trace rather than losing whatever hadn't yet
+ * been written.  A second signal ends it at once.
+ */
+static volatile sig_atomic_t	gbl_interrupted = 0;
+
+void	interrupt(int sig) {
+	gbl_interrupted = 1;
+	signal(sig, SIG_DFL);
+}
+
+/*
+ * window
+ *
+ * Parse a <first>[:<length>] trace window argument
+ */
+void	window(const char *arg, unsigned long &first, unsigned long &length) {
+	char	*end;
+
+	first = strtoul(arg, &end, 0);
+	length = (*end == ':') ? strtoul(end+1, NULL, 0) : 0;
 }
 
 int	main(int argc, char **argv) {
 	Verilated::commandArgs(argc, argv);
 
 	const	char *elfload = NULL,
-			// *profile_file = NULL,
+			*ckpt_restore = NULL, *ckpt_file = NULL,
+			*profile_file = NULL, *perf_file = NULL,
 			*trace_file = NULL; // "trace.vcd";
-	bool	debug_flag = false, willexit = false;
-	// FILE	*profile_fp;
-
-	MAINTB	*tb = new MAINTB;
+	bool	debug_flag = false, willexit = false, quiet = false,
+		bench = false, watchbus = false;
+	int	nthreads = VTHREADS;
+	unsigned long	ckpt_at = 0, trace_start = 0, trace_len = 0,
+			trace_pc = 0, trace_pclen = 0,
+			perf_interval = PERF_INTERVAL;
+	bool	trace_pcarm = false;
+	int	trace_depth = 99;
 
 	for(int argn=1; argn < argc; argn++) {
 		if (argv[argn][0] == '-') for(int j=1;
@@ -89,10 +196,26 @@ int	main(int argc, char **argv) {
 			switch(tolower(argv[argn][j])) {
 			case 'd': debug_flag = true;
 				if (trace_file == NULL)
-					trace_file = "trace.vcd";
+					trace_file = "trace" TRACEEXT;
 				break;
-			// case 'f': profile_file = "pfile.bin"; break;
+			case 'f': profile_file = "pfile.bin"; break;
+			case 'b': bench = true; break;
+			case 'c': ckpt_at = strtoul(argv[++argn], NULL, 0);
+				j=1000; break;
+			case 'i': perf_interval = strtoul(argv[++argn], NULL,0);
+				j=1000; break;
+			case 'm': perf_file = argv[++argn]; j=1000; break;
+			case 'l': trace_depth = atoi(argv[++argn]); j=1000; break;
+			case 'p': window(argv[++argn], trace_pc, trace_pclen);
+				trace_pcarm = true; j=1000; break;
+			case 'w': window(argv[++argn], trace_start, trace_len);
+				j=1000; break;
+			case 'j': nthreads = atoi(argv[++argn]); j=1000; break;
+			case 'q': quiet = true; break;
+			case 'r': ckpt_restore = argv[++argn]; j=1000; break;
+			case 's': ckpt_file = argv[++argn]; j=1000; break;
 			case 't': trace_file = argv[++argn]; j=1000; break;
+			case 'x': watchbus = true; break;
 			case 'h': usage(); exit(0); break;
 			default:
 				fprintf(stderr, "ERR: Unexpected flag, -%c\n\n",
@@ -109,7 +232,40 @@ int	main(int argc, char **argv) {
 		}
 	}
 
-	if (elfload) {
+	if (nthreads != VTHREADS)
+		runthreads(argv, nthreads);
+
+	// Only build the test bench once we know we're the one to run it,
+	// lest it grab the command port from the simulator we'd run instead
+	MAINTB	*tb = new MAINTB;
+
+	if (quiet)
+		tb->m_hb->m_log->level(ALOG_INFO);
+	if (profile_file)
+		tb->m_prof = new PCPROF(profile_file);
+	if (perf_file)
+		tb->m_perf = new PERFCTRS(perf_file, perf_interval);
+	if (watchbus)
+		tb->watchbus();
+	tb->m_ckpt_at = ckpt_at;
+	if (ckpt_file)
+		tb->m_ckpt_file = ckpt_file;
+
+	if (((trace_pcarm)||(trace_start)||(trace_len))&&(trace_file == NULL))
+		trace_file = "trace" TRACEEXT;
+	if (trace_pcarm) {
+		// Nothing gets traced until the CPU gets to trace_pc
+		tb->m_trace_armed = true;
+		tb->m_trace_pc    = trace_pc;
+		tb->m_trace_pclen = trace_pclen;
+		tb->tracewindow(ULONG_MAX);
+	} else
+		tb->tracewindow(trace_start, trace_len);
+	ASYNCLOG::signals(tb->m_hb->m_log);
+	signal(SIGINT,  interrupt);
+	signal(SIGTERM, interrupt);
+
+	if ((elfload)||(ckpt_restore)) {
 		willexit = true;
 	} else {
 		/*
@@ -136,11 +292,16 @@ int	main(int argc, char **argv) {
 		if (elfload)
 			printf("\tELF File         = %s\n", elfload);
 	} if (trace_file)
-		tb->opentrace(trace_file);
+		tb->opentrace(trace_file, trace_depth);
 
-	tb->reset();
+	if (ckpt_restore)
+		// The checkpoint already holds everything the reset and the
+		// ELF load would set up
+		tb->restore(ckpt_restore);
+	else
+		tb->reset();
 
-	if (elfload) {
+	if ((elfload)&&(!ckpt_restore)) {
 #ifdef	INCLUDE_ZIPCPU
 		tb->loadelf(elfload);
 
@@ -178,14 +339,21 @@ int	main(int argc, char **argv) {
 #endif
 	}
 
+	// The rate is reported by tb->close(), however the simulation ends
+	if (bench)
+		tb->startbench();
 	if (willexit) {
-		while(!tb->done())
+		while((!tb->done())&&(!gbl_interrupted))
 			tb->tick();
-		printf("Will exit: DONE!!\n");
+		if (!gbl_interrupted)
+			printf("Will exit: DONE!!\n");
 	} else
-		while(true)
+		while(!gbl_interrupted)
 			tb->tick();
 
+	if (gbl_interrupted)
+		printf("\nInterrupted after %lu ticks\n", tb->m_tickcount);
+
 	printf("Calling TB -> close\n"); fflush(stdout);
 	tb->close();
 	printf("Delete TB\n"); fflush(stdout);
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	busmon.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Keeps the counts, and prints the summary, for the Wishbone bus
+//		monitor described in busmon.h.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "busmon.h"
+
+BUSPORT::BUSPORT(const char *name, bool master)
+		: m_name(name), m_master(master), m_lost(false),
+		m_head(0), m_tail(0) {
+	m_busy = m_requests = m_writes = m_acks = m_errs = m_stalls = 0;
+	m_aborts = m_maxpend = m_total = m_worst = 0;
+	for(int k=0; k<BUSMON_NBINS; k++)
+		m_hist[k] = 0;
+}
+
+void	BUSPORT::latency(uint64_t ticks) {
+	int	bin = 0;
+
+	// Bin 0 holds latencies of 0 and 1, bin 1 of 2-3, bin 2 of 4-7, etc.
+	for(uint64_t t = ticks>>1; (t)&&(bin < BUSMON_NBINS-1); t >>= 1)
+		bin++;
+	m_hist[bin]++;
+	m_total += ticks;
+	if (ticks > m_worst)
+		m_worst = ticks;
+}
+
+void	BUSPORT::report(FILE *fp, uint64_t ticks, double clkhz) {
+	uint64_t	nlat = 0;
+	double		bytes;
+
+	for(int k=0; k<BUSMON_NBINS; k++)
+		nlat += m_hist[k];
+	bytes = 4.0 * m_acks;
+
+	fprintf(fp, "\n%s %s\n", (m_master) ? "Master" : "Slave", m_name);
+	fprintf(fp, "  Busy     %12lu ticks (%5.1f%%)\n",
+		(unsigned long)m_busy, (ticks) ? 100.0 * m_busy / ticks : 0.0);
+	fprintf(fp, "  Requests %12lu (%lu writes), %lu acks, %lu errors\n",
+		(unsigned long)m_requests, (unsigned long)m_writes,
+		(unsigned long)m_acks, (unsigned long)m_errs);
+	fprintf(fp, "  Stalled  %12lu ticks, %lu aborted cycles, "
+		"at most %lu outstanding\n", (unsigned long)m_stalls,
+		(unsigned long)m_aborts, (unsigned long)m_maxpend);
+	fprintf(fp, "  Bandwidth %11.3f bytes/tick", (ticks) ? bytes/ticks : 0.0);
+	if (clkhz > 0 && ticks > 0)
+		fprintf(fp, ", %.2f MB/s", bytes / ticks * clkhz / 1e6);
+	fprintf(fp, "\n");
+
+	if (nlat == 0)
+		return;
+
+	fprintf(fp, "  Latency  %12.2f ticks average, %lu worst\n",
+		(double)m_total / nlat, (unsigned long)m_worst);
+	for(int k=0; k<BUSMON_NBINS; k++) {
+		unsigned long	lo = (k) ? (1ul<<k) : 0, hi = (2ul<<k)-1;
+
+		if (m_hist[k] == 0)
+			continue;
+		if (k == BUSMON_NBINS-1)
+			fprintf(fp, "    %5lu+      ", lo);
+		else
+			fprintf(fp, "    %5lu-%-5lu ", lo, hi);
+		fprintf(fp, "%12lu %5.1f%%\n", (unsigned long)m_hist[k],
+			100.0 * m_hist[k] / nlat);
+	}
+}
+
+BUSMON::BUSMON(double clkhz) : m_nports(0), m_ticks(0), m_clkhz(clkhz) {
+}
+
+BUSMON::~BUSMON(void) {
+	for(int k=0; k<m_nports; k++)
+		delete m_port[k];
+}
+
+int	BUSMON::add(const char *name, bool master) {
+	if (m_nports >= BUSMON_MAXPORTS) {
+		fprintf(stderr, "ERR: Too many ports for the bus monitor\n");
+		exit(EXIT_FAILURE);
+	}
+
+	m_port[m_nports] = new BUSPORT(name, master);
+	return m_nports++;
+}
+
+void	BUSMON::report(FILE *fp) {
+	fprintf(fp, "\nBUS MONITOR: %lu ticks watched\n",
+		(unsigned long)m_ticks);
+
+	// Masters first, then slaves
+	for(int k=0; k<m_nports; k++)
+		if (m_port[k]->master())
+			m_port[k]->report(fp, m_ticks, m_clkhz);
+	for(int k=0; k<m_nports; k++)
+		if (!m_port[k]->master())
+			m_port[k]->report(fp, m_ticks, m_clkhz);
+}
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	busmon.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Watches the Wishbone ports on either side of the wb bus's
+//		crossbar, within the simulator.  Each master and slave port
+//	keeps its own FIFO of the requests it has outstanding, so that every
+//	acknowledgment can be matched to the request it answers.  From these
+//	come a histogram of the latency from request to acknowledgment, the
+//	number of ticks each port spent stalled, or with its cycle line high,
+//	and the bandwidth it achieved.  The whole lot is printed at the end of
+//	the run.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	BUSMON_H
+#define	BUSMON_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// The most requests any one port may have outstanding.  Any more than this
+// and the monitor loses track of the port, until its cycle ends.
+#define	BUSMON_LGPEND	6
+#define	BUSMON_MAXPEND	(1u<<BUSMON_LGPEND)
+// Latencies are binned by powers of two, up to (1<<(BUSMON_NBINS-2)) ticks,
+// with the last bin for anything longer
+#define	BUSMON_NBINS	12
+#define	BUSMON_MAXPORTS	16
+
+class	BUSPORT {
+	const char	*m_name;
+	bool		m_master, m_lost;
+	uint64_t	m_pend[BUSMON_MAXPEND];
+	unsigned	m_head, m_tail;
+
+	void	latency(uint64_t ticks);
+public:
+	uint64_t	m_busy, m_requests, m_writes, m_acks, m_errs, m_stalls,
+			m_aborts, m_maxpend, m_total, m_worst,
+			m_hist[BUSMON_NBINS];
+
+	BUSPORT(const char *name, bool master);
+
+	const char	*name(void) const { return m_name; }
+	bool		master(void) const { return m_master; }
+
+	// Called on every clock tick, with the state of the port's wires
+	void	tick(uint64_t now, bool cyc, bool stb, bool we, bool stall,
+			bool ack, bool err) {
+		if (!cyc) {
+			// Anything still outstanding was abandoned
+			if (m_head != m_tail)
+				m_aborts++;
+			m_head = m_tail = 0;
+			m_lost = false;
+			return;
+		}
+
+		m_busy++;
+		if (stb) {
+			if (stall)
+				m_stalls++;
+			else {
+				m_requests++;
+				if (we)
+					m_writes++;
+				if (m_head - m_tail >= BUSMON_MAXPEND)
+					m_lost = true;
+				else
+					m_pend[m_head++ & (BUSMON_MAXPEND-1)] = now;
+				if (m_head - m_tail > m_maxpend)
+					m_maxpend = m_head - m_tail;
+			}
+		}
+
+		if (ack || err) {
+			if (err)
+				m_errs++;
+			else
+				m_acks++;
+			if ((m_head != m_tail)&&(!m_lost))
+				latency(now - m_pend[m_tail++ & (BUSMON_MAXPEND-1)]);
+		}
+	}
+
+	// Print out this port's counts, given the number of ticks watched
+	void	report(FILE *fp, uint64_t ticks, double clkhz);
+};
+
+class	BUSMON {
+	BUSPORT		*m_port[BUSMON_MAXPORTS];
+	int		m_nports;
+	uint64_t	m_ticks;
+	double		m_clkhz;
+public:
+	BUSMON(double clkhz);
+	~BUSMON(void);
+
+	// Add a port to be watched, returning its index
+	int	add(const char *name, bool master);
+	BUSPORT	&operator[](int k) { return *m_port[k]; }
+
+	// Count one clock tick, after every port has been given it
+	void	tick(void) { m_ticks++; }
+	uint64_t	ticks(void) const { return m_ticks; }
+
+	void	report(FILE *fp);
+};
+
+#endif
@@ -46,7 +46,10 @@
 // This is useful for guaranteeing any include functions
 // your simulation needs are called.
 //
+#include <limits.h>
+#include <time.h>
 #include "verilated.h"
+#include "verilated_save.h"
 #include "Vmain.h"
 #define	BASECLASS	Vmain
 
@@ -54,11 +57,15 @@
 #include "regdefs.h"
 #include "testb.h"
 #include "sdramsim.h"
+#include "memsim.h"
 #include "zipelf.h"
 
 #include "port.h"
 #include "pportsim.h"
 #include "byteswap.h"
+#include "pcprof.h"
+#include "perfctrs.h"
+#include "busmon.h"
 //
 // SIM.DEFINES
 //
@@ -101,6 +108,22 @@
 #define	cpu_wr_ce	CPUVAR(_wr_reg_ce)
 #define	cpu_wr_reg_id	CPUVAR(_wr_reg_id)
 #define	cpu_wr_gpreg	CPUVAR(_wr_gpreg_vl)
+#define	cpu_master_ce	CPUVAR(_master_ce)
+#define	cpu_mem_ce	CPUVAR(_mem_ce)
+#define	cpu_div_ce	CPUVAR(_div_ce)
+#define	cpu_pf_valid	CPUVAR(_pf_valid)
+#define	cpu_mem_busy	CPUVAR(_mem_busy)
+#define	wb_zip_cyc	VVAR(_wb_zip_cyc)
+#define	wb_hbarb_cyc	VVAR(_wb_hbarb_cyc)
+
+// Hand the wires of Wishbone port P, on the wb bus, to bus monitor port K
+#define	WBMON(K,P)	(*m_busmon)[K].tick(now,		\
+			m_core->VVAR(_ ## P ## _cyc),		\
+			m_core->VVAR(_ ## P ## _stb),		\
+			m_core->VVAR(_ ## P ## _we),		\
+			m_core->VVAR(_ ## P ## _stall),		\
+			m_core->VVAR(_ ## P ## _ack),		\
+			m_core->VVAR(_ ## P ## _err))
 
 #ifndef VVAR
 #ifdef  NEW_VERILATOR
@@ -120,11 +143,51 @@ public:
 		// as part of the main_tb.cpp function.
 #ifdef	SDRAM_ACCESS
 
+#ifdef	SDRAM_FASTSIM
+	MEMSIM			*m_sdram;
+#else
 	SDRAMSIM		*m_sdram;
+#endif
 	
 #endif // SDRAM_ACCESS
 	int	m_cpu_bombed;
 	PPORTSIM	*m_hb;
+
+	// Checkpoints
+	//
+	// The whole test bench can be saved to a checkpoint, m_ckpt_file,
+	// and later restored from it.  A checkpoint is taken after m_ckpt_at
+	// clock ticks (if non-zero), or whenever the CPU issues a SIM 0x500
+	// instruction.
+	unsigned long	m_ckpt_at;
+	const char	*m_ckpt_file;
+	bool		m_ckpt_req;
+
+	// Trace triggers
+	//
+	// If m_trace_armed, the trace window opens, for m_trace_pclen ticks
+	// (or for good, if zero), the first time the CPU's PC reaches
+	// m_trace_pc.  The CPU can also start and stop the trace itself,
+	// with SIM 0x501 and SIM 0x502 instructions.
+	bool		m_trace_armed;
+	uint32_t	m_trace_pc;
+	unsigned long	m_trace_pclen;
+
+	// The CPU's profile, if we're keeping one
+	PCPROF		*m_prof;
+
+	// Performance counters, if we're keeping them
+	PERFCTRS	*m_perf;
+
+	// The monitor of the wb bus crossbar, if we're watching it
+	BUSMON		*m_busmon;
+
+	// Benchmarking: if m_bench, close() reports how many clock ticks
+	// have passed since startbench(), and how quickly
+	bool		m_bench;
+	unsigned long	m_bench_ticks;
+	struct timespec	m_bench_start;
+
 	MAINTB(void) {
 		// SIM.INIT
 		//
@@ -135,13 +198,32 @@ public:
 		// From sdram
 #ifdef	SDRAM_ACCESS
 
+#ifdef	SDRAM_FASTSIM
+	// A zero wait state memory, acknowledging every request on the
+	// clock after it's made
+	m_sdram = new MEMSIM(SDRAMSZB>>2, 1);
+#else
 	m_sdram = new SDRAMSIM();
+#endif
 	
 #endif // SDRAM_ACCESS
 		// From zip
 		m_cpu_bombed = 0;
 		// From hb
 		m_hb = new PPORTSIM(FPGAPORT, true);
+
+		m_ckpt_at   = 0;
+		m_ckpt_file = "main.ckpt";
+		m_ckpt_req  = false;
+
+		m_trace_armed = false;
+		m_trace_pc    = 0;
+		m_trace_pclen = 0;
+
+		m_prof = NULL;
+		m_perf = NULL;
+		m_busmon = NULL;
+		m_bench  = false;
 	}
 
 	void	reset(void) {
@@ -168,12 +250,213 @@ public:
 		m_time_ps = 0;
 	}
 
+	void	startbench(void) {
+		m_bench = true;
+		m_bench_ticks = m_tickcount;
+		clock_gettime(CLOCK_MONOTONIC, &m_bench_start);
+	}
+
 	void	close(void) {
 		m_done = true;
+		if (m_bench) {
+			struct	timespec	stop;
+			unsigned long		ticks = m_tickcount - m_bench_ticks;
+			double			secs;
+
+			clock_gettime(CLOCK_MONOTONIC, &stop);
+			secs = (stop.tv_sec - m_bench_start.tv_sec)
+				+ (stop.tv_nsec - m_bench_start.tv_nsec) * 1e-9;
+			printf("BENCH: %lu ticks in %.3f s, %.0f ticks/s\n",
+				ticks, secs, (secs > 0) ? ticks / secs : 0.0);
+			m_bench = false;
+		}
+		if (m_prof) {
+			m_prof->write();
+			delete m_prof;
+			m_prof = NULL;
+		}
+		if (m_perf) {
+			perfcount();
+			m_perf->write(true);
+			delete m_perf;
+			m_perf = NULL;
+		}
+		if (m_busmon) {
+			m_busmon->report(stdout);
+			delete m_busmon;
+			m_busmon = NULL;
+		}
+		// Get the last of the traffic out before anyone calls exit()
+		m_hb->m_log->flush();
+		// The trace is only flushed when it pauses, so close it, lest
+		// exit() lose its tail (or, for FST, leave it unreadable)
+		closetrace();
 	}
 
 	void	tick(void) {
 		TESTB<Vmain>::tick(); // Clock.size = 1
+
+#ifdef	INCLUDE_ZIPCPU
+		if (m_prof) {
+			// Only the link register of the mode we're in counts
+			if ((m_core->cpu_wr_ce)
+				&&((m_core->cpu_wr_reg_id & 0x0f)==0)
+				&&(((m_core->cpu_wr_reg_id & 0x10)!=0)==gie()))
+				m_prof->link(m_core->cpu_wr_gpreg);
+			m_prof->tick((gie()) ? m_core->cpu_upc
+					: m_core->cpu_ipc);
+		}
+
+		if (m_perf) {
+			bool	retired = (m_core->cpu_alu_ce)
+#ifdef	OPT_DIVIDE
+					||(m_core->cpu_div_ce)
+#endif
+					||(m_core->cpu_mem_ce);
+
+			if (!m_core->cpu_master_ce)
+				m_perf->m_idle++;
+			else if (retired)
+				m_perf->m_retired++;
+			else {
+				m_perf->m_stalls++;
+				if (m_core->cpu_mem_busy)
+					m_perf->m_mem_wait++;
+				else if (!m_core->cpu_pf_valid)
+					m_perf->m_pf_starved++;
+			}
+		}
+
+		if ((m_trace_armed)&&(m_core->cpu_ipc == m_trace_pc)) {
+			m_trace_armed = false;
+			tracewindow(m_tickcount, m_trace_pclen);
+		}
+#endif
+		if (m_busmon) {
+			uint64_t	now = m_busmon->ticks();
+
+			// In the order watchbus() added them
+			WBMON(0, wb_zip);
+			WBMON(1, wb_hbarb);
+			WBMON(2, wb_sdram);
+			WBMON(3, wb_bkram);
+			WBMON(4, wb_sio);
+			WBMON(5, wb_console);
+			WBMON(6, wb_watchdog);
+			WBMON(7, wb_bustimer);
+			m_busmon->tick();
+		}
+
+		if (m_perf) {
+			m_perf->m_bus_busy[PERF_ZIP] += m_core->wb_zip_cyc;
+			m_perf->m_bus_busy[PERF_HB]  += m_core->wb_hbarb_cyc;
+			if (m_perf->tick()) {
+				perfcount();
+				m_perf->write();
+			}
+		}
+
+		if ((m_ckpt_at != 0)&&(m_tickcount == m_ckpt_at))
+			m_ckpt_req = true;
+		// Checkpoints are only ever taken between clock ticks, never
+		// from within one
+		if (m_ckpt_req) {
+			m_ckpt_req = false;
+			save(m_ckpt_file);
+		}
+	}
+
+	// Start watching both sides of the wb bus crossbar: its two masters,
+	// and each of its slaves.  tick() hands each port its wires, in this
+	// same order.
+	void	watchbus(void) {
+#ifdef	CLKFREQHZ
+		m_busmon = new BUSMON(CLKFREQHZ);
+#else
+		m_busmon = new BUSMON(0);
+#endif
+		m_busmon->add("zip", true);
+		m_busmon->add("hb", true);
+		m_busmon->add("sdram", false);
+		m_busmon->add("bkram", false);
+		m_busmon->add("wb_sio", false);
+		m_busmon->add("console", false);
+		m_busmon->add("watchdog", false);
+		m_busmon->add("bustimer", false);
+	}
+
+	// Copy those counts kept elsewhere into the performance counters
+	void	perfcount(void) {
+#if	defined(SDRAM_ACCESS) && !defined(SDRAM_FASTSIM)
+		m_perf->m_row_hits   = m_sdram->row_hits();
+		m_perf->m_row_misses = m_sdram->row_misses();
+#endif
+	}
+
+	//
+	// save(), restore()
+	//
+	// Write the whole test bench to a checkpoint file: the Verilated model
+	// (which must be Verilated with --savable), the state of every
+	// simulation component, and our own counters.  restore() reads it
+	// all back, in place of a reset() and ELF load.  Connections to the
+	// host are not saved, so any client will need to reconnect.
+	//
+	void	save(const char *fname) {
+#ifdef	SAVABLE
+		VerilatedSave	os;
+
+		os.open(fname);
+		if (!os.isOpen()) {
+			fprintf(stderr, "ERR: Could not create %s\n", fname);
+			perror("O/S Err:");
+			exit(EXIT_FAILURE);
+		}
+
+		os.write(&m_time_ps, sizeof(m_time_ps));
+		os.write(&m_tickcount, sizeof(m_tickcount));
+		os.write(&m_cpu_bombed, sizeof(m_cpu_bombed));
+		os << *m_core;
+#ifdef	SDRAM_ACCESS
+		m_sdram->save(os);
+#endif
+		m_hb->save(os);
+		os.close();
+
+		printf("CHECKPOINT: %lu ticks saved to %s\n",
+			m_tickcount, fname);
+#else
+		fprintf(stderr, "ERR: No checkpoint, the model isn't savable\n");
+#endif
+	}
+
+	void	restore(const char *fname) {
+#ifdef	SAVABLE
+		VerilatedRestore	is;
+
+		is.open(fname);
+		if (!is.isOpen()) {
+			fprintf(stderr, "ERR: Could not open %s\n", fname);
+			perror("O/S Err:");
+			exit(EXIT_FAILURE);
+		}
+
+		is.read(&m_time_ps, sizeof(m_time_ps));
+		is.read(&m_tickcount, sizeof(m_tickcount));
+		is.read(&m_cpu_bombed, sizeof(m_cpu_bombed));
+		is >> *m_core;
+#ifdef	SDRAM_ACCESS
+		m_sdram->restore(is);
+#endif
+		m_hb->restore(is);
+		is.close();
+
+		printf("CHECKPOINT: Restored %lu ticks from %s\n",
+			m_tickcount, fname);
+#else
+		fprintf(stderr, "ERR: Cannot restore, the model isn't savable\n");
+		exit(EXIT_FAILURE);
+#endif
 	}
 
 
@@ -189,10 +472,18 @@ public:
 		// SIM.TICK from sdram
 #ifdef	SDRAM_ACCESS
 
+#ifdef	SDRAM_FASTSIM
+	(*m_sdram)(m_core->o_sdram_cyc, m_core->o_sdram_stb,
+		m_core->o_sdram_we, m_core->o_sdram_addr,
+		m_core->o_sdram_data, m_core->o_sdram_sel,
+		m_core->i_sdram_ack, m_core->i_sdram_stall,
+		m_core->i_sdram_data);
+#else
 	m_core->i_ram_data = (*m_sdram)(1,m_core->o_ram_cke,
 	m_core->o_ram_cs_n,m_core->o_ram_ras_n,m_core->o_ram_cas_n,
 	m_core->o_ram_we_n,m_core->o_ram_bs,m_core->o_ram_addr,
 	m_core->o_ram_drive_data,m_core->o_ram_data,m_core->o_ram_dqm);
+#endif
 	
 #endif // SDRAM_ACCESS		
 		// SIM.TICK from zip
@@ -252,7 +543,20 @@ public:
 			// FROM sdram.SIM.LOAD
 #ifdef	SDRAM_ACCESS
 
+#ifdef	SDRAM_FASTSIM
+	// The memory model keeps words, in the host's byte order
+	start = start & (-4);
+	wlen = (wlen+3)&(-4);
+	{
+		char	*bswapd = new char[wlen+8];
+		memcpy(bswapd, &buf[offset], wlen);
+		byteswapbuf(wlen>>2, (uint32_t *)bswapd);
+		m_sdram->load(start>>2, bswapd, wlen);
+		delete[] bswapd;
+	}
+#else
 	m_sdram->load(start, &buf[offset], wlen);
+#endif
 	
 #endif // SDRAM_ACCESS
 			// AUTOFPGA::Now clean up anything else
@@ -479,6 +783,15 @@ public:
 		} else if ((imm & 0x0fff00)==0x00400) {
 			// SOUT[Imm]
 			printf("%c", imm&0x0ff);
+		} else if ((imm & 0x0fffff)==0x00500) {
+			// Checkpoint, once this clock tick is complete
+			m_ckpt_req = true;
+		} else if ((imm & 0x0fffff)==0x00501) {
+			// Start tracing
+			tracewindow(m_tickcount);
+		} else if ((imm & 0x0fffff)==0x00502) {
+			// Stop tracing, until told to start again
+			tracewindow(ULONG_MAX);
 		} else { // if ((insn & 0x0f7c00000)==0x77800000)
 			uint32_t	immv = imm & 0x03fffff;
 			// Simm instruction that we dont recognize
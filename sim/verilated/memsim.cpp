@@ -155,3 +155,19 @@ void	MEMSIM::apply(const uchar wb_cyc, const uchar wb_stb, const uchar wb_we,
 }
 
 
+
+void	MEMSIM::save(VerilatedSerialize &os) {
+	os.write(m_mem, m_len * sizeof(BUSW));
+	os.write(&m_head, sizeof(m_head));
+	os.write(&m_tail, sizeof(m_tail));
+	os.write(m_fifo_ack, (m_delay_mask+1) * sizeof(int));
+	os.write(m_fifo_data, (m_delay_mask+1) * sizeof(BUSW));
+}
+
+void	MEMSIM::restore(VerilatedDeserialize &is) {
+	is.read(m_mem, m_len * sizeof(BUSW));
+	is.read(&m_head, sizeof(m_head));
+	is.read(&m_tail, sizeof(m_tail));
+	is.read(m_fifo_ack, (m_delay_mask+1) * sizeof(int));
+	is.read(m_fifo_data, (m_delay_mask+1) * sizeof(BUSW));
+}
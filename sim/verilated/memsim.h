@@ -46,6 +46,8 @@
 #ifndef	MEMSIM_H
 #define	MEMSIM_H
 
+#include "verilated_save.h"
+
 class	MEMSIM {
 public:	
 	typedef	unsigned int	BUSW;
@@ -60,6 +62,10 @@ public:
 	~MEMSIM(void);
 	void	load(const char *fname);
 	void	load(const unsigned int addr, const char *buf,const size_t len);
+	// Write the memory, and any acknowledgments still in flight, to a
+	// checkpoint, or read them back from one
+	void	save(VerilatedSerialize &os);
+	void	restore(VerilatedDeserialize &is);
 	void	apply(const uchar wb_cyc, const uchar wb_stb,
 				const uchar wb_we,
 			const BUSW wb_addr, const BUSW wb_data,
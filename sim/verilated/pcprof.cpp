@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	pcprof.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Profiles the ZipCPU, within the simulator.  See pcprof.h.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcprof.h"
+
+PCPROF::PCPROF(const char *fname) : m_fname(fname) {
+	// Calloc, so that the pages never touched are never allocated
+	m_page = (PCCOUNT **)calloc(PCPROF_NPAGES, sizeof(PCCOUNT *));
+	if (NULL == m_page) {
+		fprintf(stderr, "ERR: No memory for the profile\n");
+		exit(EXIT_FAILURE);
+	}
+
+	m_pc = 0;
+	m_link = 0;
+	m_linked = false;
+	m_ticks = 0;
+}
+
+PCPROF::~PCPROF(void) {
+	for(unsigned k=0; k<PCPROF_NPAGES; k++)
+		free(m_page[k]);
+	free(m_page);
+}
+
+PCPROF::PCCOUNT	*PCPROF::newpage(uint32_t pc) {
+	PCCOUNT	*page;
+
+	page = (PCCOUNT *)calloc(1<<PCPROF_LGPAGE, sizeof(PCCOUNT));
+	if (NULL == page) {
+		fprintf(stderr, "ERR: No memory for the profile\n");
+		exit(EXIT_FAILURE);
+	}
+
+	m_page[pc >> (PCPROF_LGPAGE+2)] = page;
+	return page;
+}
+
+/*
+ * ret
+ *
+ * Return from the call at the given depth of the stack, and so also from
+ * any calls it has yet to return from itself
+ */
+void	PCPROF::ret(unsigned depth) {
+	while(m_stack.size() > depth) {
+		FRAME		&f = m_stack.back();
+		ARCCOUNT	&a = m_arcs[((uint64_t)f.m_site << 32) | f.m_entry];
+
+		a.m_calls++;
+		a.m_cycles += m_ticks - f.m_start;
+		m_stack.pop_back();
+	}
+}
+
+/*
+ * transfer
+ *
+ * The branch at from has just taken the CPU to to.  Decide if that was a
+ * return, a call, or neither.
+ */
+void	PCPROF::transfer(uint32_t from, uint32_t to) {
+	bool	linked = m_linked;
+
+	m_linked = false;
+
+	// A return, to any of the calls on the stack--not just the last, lest
+	// one return we miss confuse us from then on
+	for(unsigned k=m_stack.size(); k>0; k--) {
+		if (m_stack[k-1].m_ret == to) {
+			ret(k-1);
+			return;
+		}
+	}
+
+	// A call: the link register was just set to come back to the
+	// instruction following this branch.  (A long call, LJSR, has a word
+	// of address between the two.)
+	if ((linked)&&(m_link > from)&&(m_link <= from + 8)
+			&&(m_stack.size() < PCPROF_MAXDEPTH)) {
+		FRAME	f;
+
+		f.m_ret   = m_link;
+		f.m_site  = from;
+		f.m_entry = to;
+		f.m_start = m_ticks;
+		m_stack.push_back(f);
+	}
+}
+
+void	PCPROF::write(void) {
+	FILE	*fp;
+	PROFHDR	hdr;
+
+	ret(0);
+
+	if (NULL == (fp = fopen(m_fname, "wb"))) {
+		fprintf(stderr, "ERR: Could not create %s\n", m_fname);
+		perror("O/S Err:");
+		return;
+	}
+
+	hdr.m_magic   = PROF_MAGIC;
+	hdr.m_version = PROF_VERSION;
+	hdr.m_npcs    = 0;
+	hdr.m_narcs   = m_arcs.size();
+	hdr.m_flags   = 0;
+	hdr.m_unused  = 0;
+	hdr.m_ticks   = m_ticks;
+	for(unsigned k=0; k<PCPROF_NPAGES; k++) {
+		if (!m_page[k])
+			continue;
+		for(unsigned j=0; j<(1u<<PCPROF_LGPAGE); j++)
+			if (m_page[k][j].m_retired || m_page[k][j].m_stalls)
+				hdr.m_npcs++;
+	}
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+
+	for(unsigned k=0; k<PCPROF_NPAGES; k++) {
+		if (!m_page[k])
+			continue;
+		for(unsigned j=0; j<(1u<<PCPROF_LGPAGE); j++) {
+			PCCOUNT	*c = &m_page[k][j];
+			PROFPC	rec;
+
+			if (!c->m_retired && !c->m_stalls)
+				continue;
+			rec.m_pc = ((k << PCPROF_LGPAGE) + j) << 2;
+			rec.m_unused  = 0;
+			rec.m_retired = c->m_retired;
+			rec.m_stalls  = c->m_stalls;
+			fwrite(&rec, sizeof(rec), 1, fp);
+		}
+	}
+
+	for(auto &a : m_arcs) {
+		PROFARC	rec;
+
+		rec.m_site   = (uint32_t)(a.first >> 32);
+		rec.m_entry  = (uint32_t)a.first;
+		rec.m_calls  = a.second.m_calls;
+		rec.m_cycles = a.second.m_cycles;
+		fwrite(&rec, sizeof(rec), 1, fp);
+	}
+
+	fclose(fp);
+	printf("PROFILE: %lu ticks written to %s\n", (unsigned long)m_ticks,
+		m_fname);
+}
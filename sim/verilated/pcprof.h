@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	pcprof.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Profiles the ZipCPU, within the simulator.  Every clock tick
+//		is charged to the instruction the CPU is waiting to retire:
+//	as a retirement, if the CPU moves on from it on that tick, or as a
+//	stall otherwise.  Calls are found by watching for a branch just after
+//	the link register (R0) has been set to the address following it, and
+//	their returns by a branch back to that address.  The result is written
+//	out, in the format of profdata.h, for zipprof to make sense of.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	PCPROF_H
+#define	PCPROF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+#include "profdata.h"
+
+// The counts are kept in pages of (1<<PCPROF_LGPAGE) instruction words,
+// allocated as the CPU first gets to them
+#define	PCPROF_LGPAGE	10
+#define	PCPROF_NPAGES	(1u<<(32-2-PCPROF_LGPAGE))
+// The deepest the call stack may go.  Anything deeper is most likely a call
+// we found that was never really a call, and isn't tracked.
+#define	PCPROF_MAXDEPTH	1024
+
+class	PCPROF {
+	typedef	struct	{
+		uint64_t	m_retired, m_stalls;
+	} PCCOUNT;
+
+	typedef	struct	{
+		uint32_t	m_ret, m_site, m_entry;
+		uint64_t	m_start;
+	} FRAME;
+
+	typedef	struct	{
+		uint64_t	m_calls, m_cycles;
+	} ARCCOUNT;
+
+	const char	*m_fname;
+	PCCOUNT		**m_page;
+	uint32_t	m_pc, m_link;
+	bool		m_linked;
+	uint64_t	m_ticks;
+	std::vector<FRAME>	m_stack;
+	std::unordered_map<uint64_t, ARCCOUNT>	m_arcs;
+
+	PCCOUNT	*newpage(uint32_t pc);
+	PCCOUNT	*count(uint32_t pc) {
+		PCCOUNT	*page = m_page[pc >> (PCPROF_LGPAGE+2)];
+
+		if (!page)
+			page = newpage(pc);
+		return &page[(pc >> 2) & ((1<<PCPROF_LGPAGE)-1)];
+	}
+
+	void	transfer(uint32_t from, uint32_t to);
+	void	ret(unsigned depth);
+public:
+	PCPROF(const char *fname);
+	~PCPROF(void);
+
+	// Called on every clock tick, with the address of the next instruction
+	// to retire
+	void	tick(uint32_t pc) {
+		m_ticks++;
+		if (pc == m_pc) {
+			count(pc)->m_stalls++;
+			return;
+		}
+
+		// There's nothing to charge the very first tick to
+		if (m_ticks > 1) {
+			count(m_pc)->m_retired++;
+			if (pc != m_pc + 4)
+				transfer(m_pc, pc);
+		}
+		m_pc = pc;
+	}
+
+	// Called whenever the link register, R0, is written
+	void	link(uint32_t v) { m_link = v; m_linked = true; }
+
+	// Write the profile out.  Calls yet to return are counted as though
+	// they had just returned.
+	void	write(void);
+};
+
+#endif
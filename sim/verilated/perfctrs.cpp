@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	perfctrs.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Writes out the simulation's performance counters.  See
+//		perfctrs.h for what they count.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "perfctrs.h"
+
+static	const char	*master_name[PERF_NMASTERS] = { "zip", "hb" };
+
+PERFCTRS::PERFCTRS(const char *fname, unsigned long interval) {
+	if (NULL == (m_fp = fopen(fname, "w"))) {
+		fprintf(stderr, "ERR: Could not create %s\n", fname);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	m_interval = interval;
+	m_next = (interval) ? interval : ~0ul;
+	clock_gettime(CLOCK_MONOTONIC, &m_start);
+	m_last = m_start;
+	m_last_ticks = 0;
+
+	m_ticks = m_retired = m_idle = m_stalls = 0;
+	m_pf_starved = m_mem_wait = 0;
+	for(int k=0; k<PERF_NMASTERS; k++)
+		m_bus_busy[k] = 0;
+	m_row_hits = m_row_misses = 0;
+}
+
+PERFCTRS::~PERFCTRS(void) {
+	fclose(m_fp);
+}
+
+double	PERFCTRS::since(const struct timespec &ts, struct timespec &now) {
+	return (now.tv_sec - ts.tv_sec) + (now.tv_nsec - ts.tv_nsec) * 1e-9;
+}
+
+/*
+ * write
+ *
+ * Two rates are given: ticks_per_second over the whole run, and
+ * interval_ticks_per_second since the counters were last written, so that
+ * a slow down part way through a run shows up.  The CPU's IPC only counts
+ * the ticks it wasn't idle.
+ */
+void	PERFCTRS::write(bool final) {
+	struct timespec	now;
+	double		secs, isecs;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs  = since(m_start, now);
+	isecs = since(m_last, now);
+
+	fprintf(m_fp, "{\"final\":%s,\"ticks\":%lu,\"seconds\":%.3f,"
+		"\"ticks_per_second\":%.0f,\"interval_ticks_per_second\":%.0f",
+		(final) ? "true" : "false", (unsigned long)m_ticks, secs,
+		(secs > 0) ? m_ticks / secs : 0.0,
+		(isecs > 0) ? (m_ticks - m_last_ticks) / isecs : 0.0);
+	fprintf(m_fp, ",\"cpu\":{\"retired\":%lu,\"ipc\":%.4f,\"idle\":%lu,"
+		"\"stalls\":%lu,\"pf_starved\":%lu,\"mem_wait\":%lu}",
+		(unsigned long)m_retired,
+		(m_ticks > m_idle) ? (double)m_retired / (m_ticks - m_idle)
+			: 0.0,
+		(unsigned long)m_idle, (unsigned long)m_stalls,
+		(unsigned long)m_pf_starved, (unsigned long)m_mem_wait);
+	fprintf(m_fp, ",\"sdram\":{\"row_hits\":%lu,\"row_misses\":%lu}",
+		(unsigned long)m_row_hits, (unsigned long)m_row_misses);
+	fprintf(m_fp, ",\"bus_busy\":{");
+	for(int k=0; k<PERF_NMASTERS; k++)
+		fprintf(m_fp, "%s\"%s\":%lu", (k) ? "," : "", master_name[k],
+			(unsigned long)m_bus_busy[k]);
+	fprintf(m_fp, "}}\n");
+	fflush(m_fp);
+
+	m_last = now;
+	m_last_ticks = m_ticks;
+	if (m_interval)
+		m_next = m_ticks + m_interval;
+}
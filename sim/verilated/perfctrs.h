@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	perfctrs.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Counts how well the simulation, and the design within it, are
+//		running: how many clock ticks per second the simulator manages,
+//	how many instructions the CPU retires, where it stalls, how often the
+//	SDRAM finds its row already open, and how busy each bus master keeps
+//	the bus.  MAINTB does the counting, on every clock tick, and the
+//	counts are written out as JSON, one object per line, every so many
+//	ticks and once more at the end.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	PERFCTRS_H
+#define	PERFCTRS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+// How often the counters are written out, in clock ticks, by default
+#define	PERF_INTERVAL	(1ul<<24)
+
+// The bus masters whose busy cycles are counted: the CPU, and the host, by
+// way of the hexbus
+#define	PERF_ZIP	0
+#define	PERF_HB		1
+#define	PERF_NMASTERS	2
+
+class	PERFCTRS {
+	FILE		*m_fp;
+	unsigned long	m_interval, m_next;
+	struct timespec	m_start, m_last;
+	uint64_t	m_last_ticks;
+
+	double	since(const struct timespec &ts, struct timespec &now);
+public:
+	// The counters themselves, for MAINTB to count with
+	uint64_t	m_ticks,
+			m_retired,	// Instructions retired
+			m_idle,		// Ticks the CPU was halted or asleep
+			m_stalls,	// Ticks the CPU ran, but retired nothing
+			m_pf_starved,	// .. of which, waiting on the prefetch
+			m_mem_wait,	// .. of which, waiting on memory
+			m_bus_busy[PERF_NMASTERS];
+	// The SDRAM counts its own row hits and misses, so these are just a
+	// copy, taken whenever the counters are written
+	uint64_t	m_row_hits, m_row_misses;
+
+	PERFCTRS(const char *fname, unsigned long interval = PERF_INTERVAL);
+	~PERFCTRS(void);
+
+	// Called at the end of every tick.  Returns true when it's time for
+	// the counters to be written.
+	bool	tick(void) {
+		return (++m_ticks >= m_next);
+	}
+
+	// Write the counters out, as one line of JSON
+	void	write(bool final = false);
+};
+
+#endif
@@ -65,7 +65,7 @@ int	PPORTSIM::setup_listener(const int port) {
 
 	signal(SIGPIPE, SIG_IGN);
 
-	if (m_debug) printf("Listening on port %d\n", port);
+	if (m_debug) m_log->printf(ALOG_INFO, "Listening on port %d", port);
 
 	skt = socket(AF_INET, SOCK_STREAM, 0);
 	if (skt < 0) {
@@ -104,15 +104,23 @@ int	PPORTSIM::setup_listener(const int port) {
 PPORTSIM::PPORTSIM(const int port, const bool copy_to_stdout)
 		: m_copy(copy_to_stdout) {
 	m_debug = true;
+	m_log = new ASYNCLOG();
+	m_chcmdin  = m_log->channel("Cmd-in");
+	m_chcmdout = m_log->channel("Cmd-out");
+	m_chconin  = m_log->channel("Con-in");
+	m_chconout = m_log->channel("Con-out");
 	m_con = m_cmd = -1;
 	m_skt = setup_listener(port);
 	m_console = setup_listener(port+1);
-	m_rxpos = m_cmdpos = m_conpos = m_ilen = 0;
+	m_rxpos = m_cmdpos = m_conpos = m_ilen = m_cllen = 0;
 	m_started_flag = false;
 	m_pp_phase = 0;
+	m_burst = 0;
 	m_tx_busy   = 0; // Flow control out of the FPGA
 	m_intransit_data = 0x0ff;
 	m_delay = PP_DELAY;
+	m_pollwait = 0;
+	m_pollinterval = 0;
 }
 
 void	PPORTSIM::kill(void) {
@@ -128,9 +136,10 @@ void	PPORTSIM::kill(void) {
 	m_cmd     = -1;
 }
 
-void	PPORTSIM::poll_accept(void) {
+bool	PPORTSIM::poll_accept(void) {
 	struct	pollfd	pb[2];
 	int	npb = 0;
+	bool	active = false;
 
 	// Check if we need to accept any connections
 	if (m_cmd < 0) {
@@ -159,24 +168,30 @@ void	PPORTSIM::poll_accept(void) {
 			if (pb[k].fd == m_skt) {
 				m_cmd = accept(m_skt, 0, 0);
 
+				active = true;
 				if (m_cmd < 0)
 					perror("CMD Accept failed:");
-				else printf("Accepted CMD connection\n");
+				else m_log->printf(ALOG_INFO,
+					"Accepted CMD connection");
 			} else if (pb[k].fd == m_console) {
 				m_con = accept(m_console, 0, 0);
+				active = true;
 				if (m_con < 0)
 					perror("CON Accept failed:");
-				else printf("Accepted CON connection\n");
+				else m_log->printf(ALOG_INFO,
+					"Accepted CON connection");
 			}
 		}
 	}
 
 	// End of trying to accept more connections
+	return active;
 }
 
-void	PPORTSIM::poll_read(void) {
+bool	PPORTSIM::poll_read(void) {
 	struct	pollfd	pb[2];
 	int		npb = 0, r;
+	bool		active = false;
 
 	if (m_cmd >= 0) {
 		pb[npb].fd = m_cmd;
@@ -189,13 +204,13 @@ void	PPORTSIM::poll_read(void) {
 	}
 
 	if (npb == 0)
-		return;
+		return false;
 
 	r = poll(pb, npb, 0);
 	if (r < 0)
 		perror("Polling error:");
 	else if (r == 0)
-		return;
+		return false;
 
 	// printf("POLL = %d\n", r);
 	for(int i=0; i<npb; i++) {
@@ -204,19 +219,22 @@ void	PPORTSIM::poll_read(void) {
 			nr =recv(pb[i].fd, &m_rxbuf[m_ilen],
 					sizeof(m_rxbuf)-m_ilen,
 					MSG_DONTWAIT);
+			if (nr > 0)
+				m_log->count((pb[i].fd == m_cmd)
+					? m_chcmdout : m_chconout, nr);
 			if (pb[i].fd == m_cmd) {
 				for(int j=0; j<nr; j++) {
 					m_cmdline[m_cllen] = m_rxbuf[j+m_ilen];
 					if (m_cmdline[m_cllen] != '\r') {
 						if (m_cmdline[m_cllen] == '\n'){
-							m_cmdline[m_cllen]='\0';
-							printf("< %s\n", m_cmdline);
+							m_log->line(m_chcmdout, "< ",
+								m_cmdline, m_cllen);
 							m_cllen=0;
 						} else
 							m_cllen++;
 					} if (m_cllen >= 64) {
-						m_cmdline[m_cllen+1] = '\0';
-						printf("< %s\n", m_cmdline);
+						m_log->line(m_chcmdout, "< ",
+							m_cmdline, m_cllen);
 						m_cllen = 0;
 					}
 					
@@ -226,10 +244,12 @@ void	PPORTSIM::poll_read(void) {
 
 				if (nr <= 0) {
 					m_cmdline[m_cllen] = '\0';
-					printf("< %s [CLOSED]\n", m_cmdline);
+					m_log->printf(ALOG_INFO, "< %s [CLOSED]",
+						m_cmdline);
 					m_cllen = 0;
 				}
-			} if (nr > 0) {
+			} active = true;
+			if (nr > 0) {
 				m_ilen += nr;
 				if (m_ilen == sizeof(m_rxbuf))
 					break;
@@ -242,6 +262,74 @@ void	PPORTSIM::poll_read(void) {
 			}
 		}
 	} m_rxpos = 0;
+
+	return active;
+}
+
+/*
+ * polled
+ *
+ * Schedule the next check of the sockets, based upon whether or not this one
+ * found anything.
+ */
+void	PPORTSIM::polled(const bool active) {
+	if (active)
+		m_pollinterval = 0;
+	else if (m_pollinterval < PPORTSIM_MINPOLL)
+		m_pollinterval = PPORTSIM_MINPOLL;
+	else if (m_pollinterval < PPORTSIM_MAXPOLL)
+		m_pollinterval <<= 1;
+	m_pollwait = m_pollinterval;
+}
+
+void	PPORTSIM::flush_cmd(void) {
+	int	snt = 0;
+
+	if (m_cmdpos <= 0)
+		return;
+
+	if (m_cmd >= 0)
+		snt = send(m_cmd,m_cmdbuf, m_cmdpos, 0);
+	if (snt < 0) {
+		m_log->printf(ALOG_INFO, "Closing CMD socket");
+		close(m_cmd);
+		m_cmd = -1;
+		snt = 0;
+	} // else printf("%d/%d bytes returned\n", snt, m_cmdpos);
+	m_log->count(m_chcmdin, m_cmdpos);
+	if (m_copy)
+		m_log->line(m_chcmdin, "> ", m_cmdbuf, m_cmdpos);
+	if (snt < m_cmdpos) {
+		// fprintf(stderr, "CMD: Only sent %d bytes of %d!\n",
+		//	snt, m_cmdpos);
+	}
+	m_cmdpos = 0;
+}
+
+void	PPORTSIM::save(VerilatedSerialize &os) {
+	os.write(&m_delay, sizeof(m_delay));
+	os.write(&m_pp_phase, sizeof(m_pp_phase));
+	os.write(&m_burst, sizeof(m_burst));
+	os.write(&m_tx_busy, sizeof(m_tx_busy));
+	os.write(&m_intransit_data, sizeof(m_intransit_data));
+	os.write(&m_started_flag, sizeof(m_started_flag));
+	os.write(&m_cmdpos, sizeof(m_cmdpos));
+	os.write(m_cmdbuf, sizeof(m_cmdbuf));
+	os.write(&m_conpos, sizeof(m_conpos));
+	os.write(m_conbuf, sizeof(m_conbuf));
+}
+
+void	PPORTSIM::restore(VerilatedDeserialize &is) {
+	is.read(&m_delay, sizeof(m_delay));
+	is.read(&m_pp_phase, sizeof(m_pp_phase));
+	is.read(&m_burst, sizeof(m_burst));
+	is.read(&m_tx_busy, sizeof(m_tx_busy));
+	is.read(&m_intransit_data, sizeof(m_intransit_data));
+	is.read(&m_started_flag, sizeof(m_started_flag));
+	is.read(&m_cmdpos, sizeof(m_cmdpos));
+	is.read(m_cmdbuf, sizeof(m_cmdbuf));
+	is.read(&m_conpos, sizeof(m_conpos));
+	is.read(m_conbuf, sizeof(m_conbuf));
 }
 
 void	PPORTSIM::received(const char ch) {
@@ -250,50 +338,41 @@ void	PPORTSIM::received(const char ch) {
 	else
 		m_conbuf[m_conpos++] = ch & 0x7f;
 	if ((m_cmdpos>0)&&((m_cmdbuf[m_cmdpos-1] == '\n')
-				||(m_cmdpos >= PPORTSIMBUFLEN-2))) {
-		int	snt = 0;
-		if (m_cmd >= 0)
-			snt = send(m_cmd,m_cmdbuf, m_cmdpos, 0);
-		if (snt < 0) {
-			printf("Closing CMD socket\n");
-			close(m_cmd);
-			m_cmd = -1;
-			snt = 0;
-		} // else printf("%d/%d bytes returned\n", snt, m_cmdpos);
-		m_cmdbuf[m_cmdpos] = '\0';
-		if (m_copy) printf("> %s", m_cmdbuf);
-		if (snt < m_cmdpos) {
-			// fprintf(stderr, "CMD: Only sent %d bytes of %d!\n",
-			//	snt, m_cmdpos);
-		}
-		m_cmdpos = 0;
-	} if ((m_conpos>0)&&((m_conbuf[m_conpos-1] == '\n')
+				||(m_cmdpos >= PPORTSIMBUFLEN-2)))
+		flush_cmd();
+	if ((m_conpos>0)&&((m_conbuf[m_conpos-1] == '\n')
 				||(m_conpos >= PPORTSIMBUFLEN-2))) {
 			int	snt = 0;
 			if (m_con >= 0) {
 				snt = send(m_con,m_conbuf, m_conpos, 0);
 				if (snt < 0) {
-					printf("Closing CONsole socket\n");
+					m_log->printf(ALOG_INFO,
+						"Closing CONsole socket");
 					close(m_con);
 					m_con = -1;
 					snt = 0;
 				}
 				if (snt < m_conpos) {
-					fprintf(stderr, "CON: Only sent %d bytes of %d!\n",
+					m_log->printf(ALOG_ERR,
+						"CON: Only sent %d bytes of %d!",
 						snt, m_conpos);
 				}
 			}
-			m_conbuf[m_conpos] = '\0';
-			printf("%s", m_conbuf);
+			m_log->count(m_chconin, m_conpos);
+			m_log->line(m_chconin, NULL, m_conbuf, m_conpos);
 			m_conpos = 0;
 	}
 }
 
 int	PPORTSIM::next(void) {
 	// If our transmit buffer is empty, see if we can
-	// fill it.
-	if (m_ilen == 0)
-		poll_read();
+	// fill it--but only if it's time to check again.
+	if ((m_ilen == 0)&&(m_pollwait == 0)) {
+		bool	active = poll_accept();
+
+		active = poll_read() || active;
+		polled(active);
+	}
 	if (m_ilen <= 0)
 		return -1;
 
@@ -307,6 +386,9 @@ int	PPORTSIM::next(void) {
 int	PPORTSIM::operator()(int &pp_clk, int &pp_dir, int pp_data, int pp_clkfb) {
 	int	r;
 
+	if (m_pollwait > 0)
+		m_pollwait--;
+
 	if (pp_dir == PP_TO_FPGA)
 		r = m_intransit_data;
 	else // else coming from the FPGA ... don't change it
@@ -334,11 +416,18 @@ int	PPORTSIM::operator()(int &pp_clk, int &pp_dir, int pp_data, int pp_clkfb) {
 		// Check if we just read something
 		if ((pp_dir == PP_FROM_FPGA)&&(pp_data != 0x0ff))
 			received(pp_data);
+		else if (pp_dir == PP_FROM_FPGA)
+			// The FPGA has nothing more to send.  Forward
+			// whatever we have, since the binary bus doesn't
+			// end its responses with a newline.
+			flush_cmd();
 		m_delay = PP_DELAY;
 		return r;
 	}
 
-	if (pp_dir != PP_TO_FPGA) {
+	// Send a burst of up to PPORTSIM_BURSTLN bytes before turning around
+	// to read back whatever the FPGA has for us
+	if ((pp_dir != PP_TO_FPGA)||(m_burst < PPORTSIM_BURSTLN)) {
 		// Check if we want to send something
 		int	vl;
 		vl = next();
@@ -347,17 +436,17 @@ int	PPORTSIM::operator()(int &pp_clk, int &pp_dir, int pp_data, int pp_clkfb) {
 			pp_dir = PP_TO_FPGA;
 			pp_clk = 1;
 			m_delay = PP_DELAY;
+			m_burst++;
 			return m_intransit_data;
 		}
 	}
 
-	poll_accept();
-
 	// Otherwise, let's run a cycle and see if the FPGA has anything to
 	// send to us.
 	pp_clk = 1;
 	pp_dir = PP_FROM_FPGA;
 	m_delay = PP_DELAY;
+	m_burst = 0;
 
 	return pp_data;
 }
@@ -76,7 +76,9 @@
 #include <arpa/inet.h>
 #include <signal.h>
 
+#include "verilated_save.h"
 #include "port.h"
+#include "asynclog.h"
 
 // #define	i_pp_dir
 // #define	i_pp_clk
@@ -84,10 +86,23 @@
 // #define	o_pp_data	io_pp_data
 
 #define	PPORTSIMBUFLEN	256
+// The most bytes sent to the FPGA at once, without reading any back.  This
+// matches PP_BURSTLN in netpport.
+#define	PPORTSIM_BURSTLN	32
+// How often, in clocks, we check our sockets for anything new.  While the host
+// is talking to us, we check at every opportunity.  Every check that finds
+// nothing doubles the time to the next, from PPORTSIM_MINPOLL up to
+// PPORTSIM_MAXPOLL, so that an idle simulation spends its time simulating
+// rather than in poll().
+#define	PPORTSIM_MINPOLL	16
+#define	PPORTSIM_MAXPOLL	65536
 
 class	PPORTSIM {
 	bool	m_debug;
 	unsigned m_delay;
+	// Clocks until we next check the sockets, and the interval between
+	// checks
+	unsigned m_pollwait, m_pollinterval;
 
 	// setup_listener is an attempt to encapsulate all of the network
 	// related setup stuff.
@@ -105,12 +120,18 @@ public:
 		m_cmdline[PPORTSIMBUFLEN],
 		m_intransit_data;
 	int	m_ilen, m_rxpos, m_cmdpos, m_conpos, m_tx_busy, m_cllen,
-		m_pp_phase;
+		m_pp_phase, m_burst;
 	bool	m_started_flag;
 	bool	m_copy;
+	// Everything we say about the traffic, both to and from the FPGA,
+	// goes through this log.  Its channels count the bytes each way.
+	ASYNCLOG	*m_log;
+	int	m_chcmdin, m_chcmdout, m_chconin, m_chconout;
 
-		void	poll_accept(void);
-		void	poll_read(void);
+		// Each returns true if it found anything to do
+		bool	poll_accept(void);
+		bool	poll_read(void);
+		void	polled(const bool active);
 public:
 
 	PPORTSIM(const int port = FPGAPORT, const bool copy_to_stdout=true);
@@ -129,6 +150,14 @@ public:
 
 	// Having just received a character, report it as received
 	void	received(const char ch);
+	// Forward any command channel bytes received so far to the host
+	void	flush_cmd(void);
+
+	// Write the state of the port, as the FPGA sees it, to a checkpoint,
+	// or read it back from one.  Our connections to the host, and any
+	// bytes it has sent that we've yet to pass on, are not part of it.
+	void	save(VerilatedSerialize &os);
+	void	restore(VerilatedDeserialize &is);
 	//
 	// Get the next character to transmit (if any)
 	int	next(void);
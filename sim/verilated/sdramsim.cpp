@@ -91,26 +91,23 @@ short	SDRAMSIM::operator()(int clk, int cke, int cs_n, int ras_n, int cas_n, int
 			// }}}
 		} else if (m_pwrup == 2) {
 			// {{{
-			static	bool	mode_is_set = false;
-			static	int	refresh_cycles = 0;
-
 			if ((!cs_n)&&(!ras_n)&&(!cas_n)&&(!we_n)) {
-				assert(!mode_is_set);
-				assert((refresh_cycles == 0)||(refresh_cycles == 8));
+				assert(!m_mode_is_set);
+				assert((m_refresh_cycles == 0)||(m_refresh_cycles == 8));
 				// mode set
 				if (m_debug) printf("SDRAM: Mode set: %08x\n", addr);
 				assert(addr == 0x021);
-				mode_is_set = true;
+				m_mode_is_set = true;
 			}
 
 			if ((!cs_n)&&(!ras_n)&&(!cas_n)&&(we_n)) {
-				refresh_cycles++;
-				assert(refresh_cycles <= 8);
+				m_refresh_cycles++;
+				assert(m_refresh_cycles <= 8);
 
-				if (m_debug) printf("SDRAM: #%d refresh cycles\n", refresh_cycles);
+				if (m_debug) printf("SDRAM: #%d refresh cycles\n", m_refresh_cycles);
 			}
 
-			if (mode_is_set && refresh_cycles >= 8) {
+			if (m_mode_is_set && m_refresh_cycles >= 8) {
 				const int tRSC = 2;
 				m_pwrup++;
 				for(int i=0; i<m_nrefresh; i++)
@@ -247,9 +244,15 @@ short	SDRAMSIM::operator()(int clk, int cke, int cs_n, int ras_n, int cas_n, int
 			m_bank_status[bs] |= 4;
 			m_bank_open_time[bs] = MAX_BANKOPEN_TIME;
 			m_bank_row[bs] = addr;
+			m_bank_used[bs&3] = false;
 			// }}}
 		} else if ((!cs_n)&&(ras_n)&&(!cas_n)) {
 			if (m_debug) printf("SDRAM: R/W Op\n");
+			if (m_bank_used[bs&3])
+				m_row_hits++;
+			else
+				m_row_misses++;
+			m_bank_used[bs&3] = true;
 			if (!we_n) {
 				// Initiate a write
 				// {{{
@@ -333,4 +336,52 @@ short	SDRAMSIM::operator()(int clk, int cke, int cs_n, int ras_n, int cas_n, int
 	return result & 0x0ffff;
 }
 
+void	SDRAMSIM::save(VerilatedSerialize &os) {
+	os.write(&m_pwrup, sizeof(m_pwrup));
+	os.write(m_mem, SDRAMSZB);
+	os.write(&m_last_value, sizeof(m_last_value));
+	os.write(m_qmem, sizeof(m_qmem));
+	os.write(m_bank_status, sizeof(m_bank_status));
+	os.write(m_bank_row, sizeof(m_bank_row));
+	os.write(m_bank_open_time, sizeof(m_bank_open_time));
+	os.write(m_bank_used, sizeof(m_bank_used));
+	os.write(&m_row_hits, sizeof(m_row_hits));
+	os.write(&m_row_misses, sizeof(m_row_misses));
+	os.write(m_refresh_time, sizeof(unsigned)*(1<<13));
+	os.write(&m_refresh_loc, sizeof(m_refresh_loc));
+	os.write(&m_nrefresh, sizeof(m_nrefresh));
+	os.write(&m_qloc, sizeof(m_qloc));
+	os.write(m_qdata, sizeof(m_qdata));
+	os.write(&m_qmask, sizeof(m_qmask));
+	os.write(&m_wr_addr, sizeof(m_wr_addr));
+	os.write(&m_clocks_till_idle, sizeof(m_clocks_till_idle));
+	os.write(&m_next_wr, sizeof(m_next_wr));
+	os.write(&m_mode_is_set, sizeof(m_mode_is_set));
+	os.write(&m_refresh_cycles, sizeof(m_refresh_cycles));
+	os.write(&m_fail, sizeof(m_fail));
+}
 
+void	SDRAMSIM::restore(VerilatedDeserialize &is) {
+	is.read(&m_pwrup, sizeof(m_pwrup));
+	is.read(m_mem, SDRAMSZB);
+	is.read(&m_last_value, sizeof(m_last_value));
+	is.read(m_qmem, sizeof(m_qmem));
+	is.read(m_bank_status, sizeof(m_bank_status));
+	is.read(m_bank_row, sizeof(m_bank_row));
+	is.read(m_bank_open_time, sizeof(m_bank_open_time));
+	is.read(m_bank_used, sizeof(m_bank_used));
+	is.read(&m_row_hits, sizeof(m_row_hits));
+	is.read(&m_row_misses, sizeof(m_row_misses));
+	is.read(m_refresh_time, sizeof(unsigned)*(1<<13));
+	is.read(&m_refresh_loc, sizeof(m_refresh_loc));
+	is.read(&m_nrefresh, sizeof(m_nrefresh));
+	is.read(&m_qloc, sizeof(m_qloc));
+	is.read(m_qdata, sizeof(m_qdata));
+	is.read(&m_qmask, sizeof(m_qmask));
+	is.read(&m_wr_addr, sizeof(m_wr_addr));
+	is.read(&m_clocks_till_idle, sizeof(m_clocks_till_idle));
+	is.read(&m_next_wr, sizeof(m_next_wr));
+	is.read(&m_mode_is_set, sizeof(m_mode_is_set));
+	is.read(&m_refresh_cycles, sizeof(m_refresh_cycles));
+	is.read(&m_fail, sizeof(m_fail));
+}
@@ -43,6 +43,8 @@
 // }}}
 #ifndef	SDRAMSIM_H
 
+#include "verilated_save.h"
+
 #define	NBANKS	4
 #define	POWERED_UP_STATE	6
 #define	CLK_RATE_HZ		100000000 // = 100 MHz = 100 * 10^6
@@ -61,11 +63,18 @@ class	SDRAMSIM {
 	int	m_bank_status[NBANKS];
 	int	m_bank_row[NBANKS];
 	int	m_bank_open_time[NBANKS];
+	// Whether each bank's row has been read or written since it was
+	// activated, so we can tell row hits from row misses
+	bool	m_bank_used[NBANKS];
+	unsigned long	m_row_hits, m_row_misses;
 	unsigned	*m_refresh_time;
 	int		m_refresh_loc, m_nrefresh;
 	int	m_qloc, m_qdata[SDRAM_QSZ], m_qmask, m_wr_addr;
 	int	m_clocks_till_idle;
 	bool	m_next_wr;
+	// Power up progress, while setting the mode and refreshing
+	bool	m_mode_is_set;
+	int	m_refresh_cycles;
 	unsigned	m_fail;
 	bool		m_debug;
 public:
@@ -90,7 +99,14 @@ public:
 		m_next_wr = true;
 		m_fail = 0;
 
+		m_mode_is_set = false;
+		m_refresh_cycles = 0;
+
 		m_debug = false;
+
+		for(int i=0; i<NBANKS; i++)
+			m_bank_used[i] = false;
+		m_row_hits = m_row_misses = 0;
 	}
 
 	~SDRAMSIM(void) {
@@ -103,6 +119,16 @@ public:
 			int driv, short data, short dqm);
 	int	pwrup(void) const { return m_pwrup; }
 
+	// Reads and writes that found their row already in use, and those
+	// that had to wait for it to be activated first
+	unsigned long	row_hits(void) const { return m_row_hits; }
+	unsigned long	row_misses(void) const { return m_row_misses; }
+
+	// Write our memory, and the state of every bank, to a checkpoint, or
+	// read them back from one
+	void	save(VerilatedSerialize &os);
+	void	restore(VerilatedDeserialize &is);
+
 	void	load(unsigned addr, const char *data, size_t len) {
 		short		*dp;
 		const char	*sp = data;
@@ -48,9 +48,11 @@
 #include <stdint.h>
 #ifdef	TRACE_FST
 #define	TRACECLASS	VerilatedFstC
+#define	TRACEEXT	".fst"
 #include <verilated_fst_c.h>
 #else // TRACE_FST
 #define	TRACECLASS	VerilatedVcdC
+#define	TRACEEXT	".vcd"
 #include <verilated_vcd_c.h>
 #endif
 
@@ -69,6 +71,11 @@ public:
 	TRACECLASS*	m_trace;
 	bool		m_done, m_paused_trace;
 	uint64_t	m_time_ps;
+	unsigned long	m_tickcount;
+	// The trace window: tracing starts at clock tick m_trace_start, and
+	// stops at m_trace_stop, if non-zero
+	unsigned long	m_trace_start, m_trace_stop;
+	bool		m_in_window;
 
 	//
 	// Since design has only one clock within it, we won't need to use the
@@ -78,6 +85,9 @@ public:
 	TESTB(void) {
 		m_core = new VA;
 		m_time_ps  = 0ul;
+		m_tickcount = 0ul;
+		m_trace_start = m_trace_stop = 0ul;
+		m_in_window = true;
 		m_trace    = NULL;
 		m_done     = false;
 		m_paused_trace = false;
@@ -94,18 +104,42 @@ public:
 	//
 	// Useful for beginning a (VCD) trace.  To open such a trace, just call
 	// opentrace() with the name of the VCD file you'd like to trace
-	// everything into
+	// everything into, and how many levels of the design's hierarchy
+	// to trace.  If a trace window has been set, nothing will be written
+	// until that window opens.
 	virtual	void	opentrace(const char *vcdname, int depth=99) {
 		if (!m_trace) {
 			m_trace = new TRACECLASS;
-			m_core->trace(m_trace, 99);
+			m_core->trace(m_trace, depth);
 			m_trace->spTrace()->set_time_resolution("ps");
 			m_trace->spTrace()->set_time_unit("ps");
 			m_trace->open(vcdname);
-			m_paused_trace = false;
+			m_in_window = inwindow();
+			m_paused_trace = !m_in_window;
 		}
 	}
 
+	// Is the current clock tick within the trace window?
+	bool	inwindow(void) const {
+		return (m_tickcount >= m_trace_start)
+			&& ((m_trace_stop == 0)||(m_tickcount < m_trace_stop));
+	}
+
+	//
+	// tracewindow(start, length)
+	//
+	// Only trace from clock tick start, and then for length ticks--or
+	// until the end, if length is zero.  A window may be set before or
+	// after the trace is opened, or set again once one has closed.  The
+	// trace is paused, or resumed, as the window closes or opens.
+	//
+	void	tracewindow(unsigned long start, unsigned long length=0) {
+		m_trace_start = start;
+		m_trace_stop  = (length) ? start + length : 0;
+		m_in_window = inwindow();
+		pausetrace(!m_in_window);
+	}
+
 	//
 	// trace()
 	//
@@ -125,6 +159,10 @@ public:
 	// function
 	//
 	virtual	bool	pausetrace(bool pausetrace) {
+		// The trace is only flushed when it pauses, or closes, rather
+		// than on every tick
+		if (pausetrace && !m_paused_trace && m_trace)
+			m_trace->flush();
 		m_paused_trace = pausetrace;
 		return m_paused_trace;
 	}
@@ -173,6 +211,12 @@ public:
 	// design, this will advance the clocks up until the nearest clock
 	// transition.
 	virtual	void	tick(void) {
+		// Open, or close, the trace window
+		if (m_trace && (inwindow() != m_in_window)) {
+			m_in_window = !m_in_window;
+			pausetrace(!m_in_window);
+		}
+
 		// Pre-evaluate, to give verilator a chance
 		// to settle any combinatorial logic that
 		// that may have changed since the last clock
@@ -187,10 +231,8 @@ public:
 		eval();
 		// If we are keeping a trace, dump the current state to that
 		// trace now
-		if (m_trace && !m_paused_trace) {
+		if (m_trace && !m_paused_trace)
 			m_trace->dump(m_time_ps);
-			m_trace->flush();
-		}
 
 		// <SINGLE CLOCK ONLY>:
 		// Advance the clock again, so that it has its negative edge
@@ -202,6 +244,7 @@ public:
 		// Call to see if any simulation components need
 		// to advance their inputs based upon this clock
 		sim_clk_tick();
+		m_tickcount++;
 	}
 
 	virtual	void	sim_clk_tick(void) {
@@ -0,0 +1,293 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	asynclog.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	A log of the traffic through a bridge, written out by a
+//		background thread.  See asynclog.h for how to use it.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include "asynclog.h"
+
+// How long the writer sleeps when it has nothing to write, in microseconds
+#define	ALOG_IDLE_US	5000
+// How often, in seconds, the writer reports any lines that have been dropped
+#define	ALOG_DROP_INTERVAL	1.0
+
+// Each record in the ring is one of these, followed by m_len bytes of text.
+// Since the prefix is only printed later, by the writer, it must be a string
+// that will outlive the record, such as a constant.
+typedef	struct	{
+	const char	*m_prefix;
+	unsigned	m_len;
+} LOGREC;
+
+static	ASYNCLOG	*gbl_log = NULL;
+
+static	double	now(void) {
+	struct	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+ASYNCLOG::ASYNCLOG(const char *fname, int level, unsigned maxrate)
+		: m_ring(ALOG_RINGSZ), m_level(level), m_done(false),
+		m_report(false), m_flush(false), m_dropped(0) {
+	if (NULL == fname)
+		m_fp = stdout;
+	else if (NULL == (m_fp = fopen(fname, "w"))) {
+		fprintf(stderr, "ERR: Could not open %s\n", fname);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	m_nchan = 0;
+	for(int k=0; k<ALOG_MAXCHAN; k++) {
+		m_chname[k] = NULL;
+		m_bytes[k] = 0;
+		m_lines[k] = 0;
+	}
+
+	m_maxrate = maxrate;
+	m_tokens  = maxrate;
+	m_last    = 0.0;
+
+	if (pthread_create(&m_writer, NULL, writer, this) != 0) {
+		fprintf(stderr, "ERR: Could not start the log writer\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+ASYNCLOG::~ASYNCLOG(void) {
+	if (gbl_log == this)
+		gbl_log = NULL;
+	m_done = true;
+	pthread_join(m_writer, NULL);
+	if (m_fp != stdout)
+		fclose(m_fp);
+}
+
+void	ASYNCLOG::level(int lvl) {
+	m_level = lvl;
+}
+
+int	ASYNCLOG::channel(const char *name) {
+	if (m_nchan >= ALOG_MAXCHAN) {
+		fprintf(stderr, "ERR: Too many log channels\n");
+		exit(EXIT_FAILURE);
+	}
+
+	m_chname[m_nchan] = name;
+	return m_nchan++;
+}
+
+/*
+ * put
+ *
+ * Place one record into the ring.  The record is built up first and written
+ * all at once, so the writer never sees half of one.  If there's no room,
+ * it's dropped.
+ */
+void	ASYNCLOG::put(int lvl, const char *prefix, const char *text,
+		unsigned len) {
+	char	rec[sizeof(LOGREC) + ALOG_LINELN];
+	LOGREC	*hdr = (LOGREC *)rec;
+
+	if (lvl > m_level.load(std::memory_order_relaxed))
+		return;
+	if (len > ALOG_LINELN)
+		len = ALOG_LINELN;
+
+	if (m_ring.room() < sizeof(LOGREC) + len) {
+		m_dropped++;
+		return;
+	}
+
+	hdr->m_prefix = prefix;
+	hdr->m_len    = len;
+	memcpy(&rec[sizeof(LOGREC)], text, len);
+	m_ring.write(rec, sizeof(LOGREC) + len);
+}
+
+void	ASYNCLOG::line(int chan, const char *prefix, const char *text,
+		unsigned len) {
+	m_lines[chan].store(m_lines[chan].load(std::memory_order_relaxed)+1,
+			std::memory_order_relaxed);
+
+	if (m_level.load(std::memory_order_relaxed) < ALOG_DATA)
+		return;
+
+	if (m_maxrate) {
+		double	tm = now();
+
+		// Refill the bucket with the time that has passed, holding
+		// no more than a second's worth of lines
+		m_tokens += (tm - m_last) * m_maxrate;
+		m_last = tm;
+		if (m_tokens > m_maxrate)
+			m_tokens = m_maxrate;
+
+		if (m_tokens < 1.0) {
+			m_dropped++;
+			return;
+		} m_tokens -= 1.0;
+	}
+
+	while((len > 0)&&((text[len-1] == '\n')||(text[len-1] == '\r')))
+		len--;
+
+	put(ALOG_DATA, prefix, text, len);
+}
+
+void	ASYNCLOG::printf(int lvl, const char *fmt, ...) {
+	char	buf[ALOG_LINELN];
+	va_list	args;
+	int	len;
+
+	if (lvl > m_level.load(std::memory_order_relaxed))
+		return;
+
+	va_start(args, fmt);
+	len = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+
+	if (len < 0)
+		return;
+	if ((unsigned)len >= sizeof(buf))
+		len = sizeof(buf)-1;
+	while((len > 0)&&(buf[len-1] == '\n'))
+		len--;
+
+	put(lvl, NULL, buf, len);
+}
+
+/*
+ * drain
+ *
+ * Write out every record in the ring, returning true if there were any
+ */
+bool	ASYNCLOG::drain(void) {
+	LOGREC	hdr;
+	char	text[ALOG_LINELN];
+	bool	any = false;
+
+	while(m_ring.fill() >= sizeof(LOGREC)) {
+		m_ring.read((char *)&hdr, sizeof(hdr));
+		m_ring.read(text, hdr.m_len);
+		fprintf(m_fp, "%s%.*s\n", (hdr.m_prefix) ? hdr.m_prefix : "",
+			(int)hdr.m_len, text);
+		any = true;
+	}
+
+	return any;
+}
+
+void	ASYNCLOG::write_counters(void) {
+	for(int k=0; k<m_nchan; k++)
+		fprintf(m_fp, "%-12s: %12lu bytes, %10lu lines\n",
+			m_chname[k], m_bytes[k].load(), m_lines[k].load());
+	fprintf(m_fp, "%-12s: %10lu lines\n", "Dropped", m_dropped.load());
+}
+
+void	*ASYNCLOG::writer(void *vlog) {
+	ASYNCLOG	*log = (ASYNCLOG *)vlog;
+	unsigned long	dropped = 0;
+	double		last_drop = 0.0;
+
+	while(1) {
+		// Check for being done, or asked to flush, before draining,
+		// so that nothing logged before we were asked gets lost
+		bool	done = log->m_done.load(), flush = log->m_flush.load(),
+			any;
+		unsigned long	ndropped;
+
+		any = log->drain();
+
+		// Drops come in floods, so they're only reported every so often
+		ndropped = log->m_dropped.load();
+		if (ndropped != dropped && (done || flush
+				|| now() - last_drop >= ALOG_DROP_INTERVAL)) {
+			fprintf(log->m_fp, "[%lu lines dropped]\n",
+				ndropped - dropped);
+			dropped = ndropped;
+			last_drop = now();
+		}
+
+		if (log->m_report.exchange(false)) {
+			log->write_counters();
+			any = true;
+		}
+
+		if (!any) {
+			fflush(log->m_fp);
+			if (flush)
+				log->m_flush = false;
+			if (done)
+				break;
+			usleep(ALOG_IDLE_US);
+		}
+	}
+
+	return NULL;
+}
+
+void	ASYNCLOG::flush(void) {
+	m_flush = true;
+	while(m_flush.load())
+		usleep(ALOG_IDLE_US/4);
+}
+
+void	ASYNCLOG::handler(int sig) {
+	ASYNCLOG	*log = gbl_log;
+
+	if (NULL == log)
+		return;
+	if (sig == SIGUSR1)
+		log->level((log->level() >= ALOG_DATA) ? ALOG_INFO : ALOG_DATA);
+	else if (sig == SIGUSR2)
+		log->report();
+}
+
+void	ASYNCLOG::signals(ASYNCLOG *log) {
+	gbl_log = log;
+	signal(SIGUSR1, handler);
+	signal(SIGUSR2, handler);
+}
@@ -0,0 +1,750 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	binbus.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	This is the C++ program on the command side that will interact
+//		with the binary framed debugging bus on an FPGA, to command the
+//	WISHBONE on that same FPGA to ... whatever we wish to command it to do.
+//
+//	Commands are sent as a header byte, 7'b1cc_nnnn, followed by any
+//	payload:
+//
+//		0x40 | (n-1)	Read n words, 1 <= n <= 16
+//		0x50 | (n-1)	Write n words, followed by n payloads
+//		0x60		Set address, followed by one payload
+//		0x7f		Reset
+//
+//	A payload is a 32-bit word sent as five bytes, most significant first:
+//	the top four bits, followed by four groups of seven.
+//
+//	Responses start with a byte, 7'b0tt_dddd:
+//
+//		0x00 | d[31:28]	Read data, four more bytes follow
+//		0x10 | a[31:28]	Address, four more bytes follow
+//		0x20 | (n-1)	n write acknowledgements
+//		0x30		Bus reset
+//		0x31		Bus error
+//		0x32		Interrupt
+//		0x33		Idle
+//
+//	The four bytes following read data or an address are XOR'd with 0x2a,
+//	and any 0x7e or 0x7f that results is sent as 0x7e followed by its
+//	bottom bit.  This keeps 0x7f, the idle character, out of the stream.
+//
+//	This code does not run on an FPGA, is not a test bench, neither is it a
+//	simulator.  It is a portion of a command program for commanding an FPGA.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "binbus.h"
+
+// Command headers
+#define	BINB_READ	0x40
+#define	BINB_WRITE	0x50
+#define	BINB_ADDR	0x60
+#define	BINB_RESET	0x7f
+
+// Response types, found in bits [6:4] of the first byte of any response
+#define	BINB_RSPDATA	0
+#define	BINB_RSPADDR	1
+#define	BINB_RSPACK	2
+#define	BINB_RSPSPECIAL	3
+
+// Special responses, found in the bottom bits of the same
+#define	BINB_SPCRESET	0
+#define	BINB_SPCERR	1
+#define	BINB_SPCINT	2
+#define	BINB_SPCIDLE	3
+
+#define	BINB_SCRAMBLE	0x2a
+#define	BINB_ESCAPE	0x7e
+
+//
+// As with the HEXBUS, you can define DBGPRINTF to be either printf or
+// filedump (both found in hexbus.cpp) to trace what's going on.
+//
+// #define	DBGPRINTF	printf
+// #define	DBGPRINTF	filedump
+//
+#ifndef	DBGPRINTF
+#define	DBGPRINTF	null
+#else
+#warning "BINBUS DEBUG IS TURNED ON"
+#endif
+
+extern	void	null(...);
+extern	void	filedump(const char *fmt, ...);
+
+/*
+ * lclreadcode
+ *
+ * Read from our interface, and drop any idle characters (bottom seven bits
+ * set) from any interaction.
+ */
+int	BINBUS::lclreadcode(char *buf, int len) {
+	int	nr, nv = 0;
+
+	nr = m_dev->read(buf, len);
+	m_total_nread += nr;
+	for(int i=0; i<nr; i++) {
+		if ((buf[i]&0x7f)!=0x7f)
+			buf[nv++] = buf[i] & 0x7f;
+	} return nv;
+}
+
+/*
+ * bufalloc
+ *
+ * Allocate a buffer of at least length (len).  This is similar to realloc().
+ *
+ */
+void	BINBUS::bufalloc(int len) {
+	if ((m_buf)&&(m_buflen >= len))
+		return;
+	if (m_buf)
+		delete[] m_buf;
+	m_buflen = (len&(-0x3f))+0x40;
+	m_buf = new char[m_buflen];
+}
+
+/*
+ * reset
+ *
+ * Send enough reset characters that the FPGA will see at least one of them
+ * as a command header, no matter where it was within any prior command.
+ */
+void	BINBUS::reset(void) {
+	char	cmd[5];
+
+	memset(cmd, BINB_RESET, sizeof(cmd));
+	m_dev->write(cmd, sizeof(cmd));
+	m_addr_set = false;
+}
+
+/*
+ * writeio
+ *
+ * Write a single value to the debugging interface
+ */
+void	BINBUS::writeio(const BUSW a, const BUSW v) {
+	writev(a, 0, 1, &v);
+	m_lastaddr = a; m_addr_set = true;
+}
+
+/*
+ * writev
+ *
+ * The internal write function, through which all writes pass.
+ *
+ * Parameters:
+ *	a	is the address to write to
+ *	p	=1 to increment address, 0 otherwise
+ *	len	The number of values to write to the bus
+ *	buf	A memory pointer to the information to write
+ *
+ * As with the HEXBUS, up to m_wrwindow writes may be unacknowledged at any
+ * one time, and acknowledgements are collected between batches.  Each
+ * batch is sent as one or more write commands of up to BINB_MAXBURST words
+ * each.  The FPGA may return several acknowledgements within a single
+ * byte, so we count acknowledgements rather than responses.
+ */
+void	BINBUS::writev(const BUSW a, const int p, const int len,
+		const BUSW *buf) {
+	char	*ptr;
+	unsigned	nw = 0;
+
+	if (len <= 0)
+		return;
+	DBGPRINTF("BB-WRITEV(%08x,%d,#%d,0x%08x ...)\n", a, p, len, buf[0]);
+
+	// Every word takes five bytes, plus one more per command header
+	bufalloc(6*m_wrwindow + 16);
+
+	ptr = encode_address(m_buf, a|((p)?0:1));
+	m_lastaddr = a; m_addr_set = true; m_inc = p;
+	m_nacks = 0;
+
+	try {
+	    while(nw < (unsigned)len) {
+		if (nw - m_nacks > (unsigned)m_wrwindow/2) {
+			waitacks(nw - m_wrwindow/2);
+			continue;
+		}
+
+		while((nw < (unsigned)len)&&(nw - m_nacks < (unsigned)m_wrwindow)) {
+			unsigned	n = len - nw;
+
+			if (n > m_wrwindow - (nw - m_nacks))
+				n = m_wrwindow - (nw - m_nacks);
+			if (n > BINB_MAXBURST)
+				n = BINB_MAXBURST;
+
+			*ptr++ = BINB_WRITE | (n-1);
+			for(unsigned k=0; k<n; k++)
+				ptr = encode_word(ptr, buf[nw++]);
+		}
+
+		m_dev->write(m_buf, ptr-m_buf);
+		DBGPRINTF("BB-WRITEV: %d writes outstanding\n", nw - m_nacks);
+		ptr = m_buf;
+
+		readidle();
+	    }
+
+	    waitacks(len);
+	} catch(BUSERR b) {
+		BUSW	erraddr = a + ((p)?(m_nacks<<2):0);
+
+		DBGPRINTF("BB-WRITEV::BUSERR writing %08x\n", erraddr);
+
+		flushacks(nw - m_nacks - 1);
+		m_bus_err = true;
+		m_addr_set = false;
+		throw BUSERR(erraddr);
+	}
+
+	m_lastaddr = a + ((p)?(len<<2):0);
+}
+
+/*
+ * waitacks
+ *
+ * Block until at least nacks write acknowledgements have been received.
+ * Will throw a BUSERR if a bus error is received along the way.
+ */
+void	BINBUS::waitacks(unsigned nacks) {
+	while(m_nacks < nacks) {
+		m_dev->poll(BINB_ACKTIMEOUT);
+		readidle();
+	}
+}
+
+/*
+ * flushacks
+ *
+ * Following a bus error in the middle of a windowed write, read and discard
+ * the responses to any writes that were still outstanding.
+ */
+void	BINBUS::flushacks(int count) {
+	unsigned	target = m_nacks + 1 + count;	// +1 for the error
+
+	DBGPRINTF("BB-FLUSH-ACKS(%d)\n", count);
+	while(m_nacks + 1 < target) {
+		if (!m_dev->poll(BINB_ACKTIMEOUT))
+			break;
+		try {
+			readidle();
+		} catch(BUSERR b) {
+			target--;
+		}
+	}
+}
+
+/*
+ * writez
+ *
+ * Write a buffer of values to a single address.
+ */
+void	BINBUS::writez(const BUSW a, const int len, const BUSW *buf) {
+	writev(a, 0, len, buf);
+}
+
+/*
+ * writei
+ *
+ * Write a buffer of values to a memory range, incrementing the address
+ * after every write.
+ */
+void	BINBUS::writei(const BUSW a, const int len, const BUSW *buf) {
+	writev(a, 1, len, buf);
+}
+
+/*
+ * readio
+ *
+ * Read a single value from the bus.
+ */
+BINBUS::BUSW	BINBUS::readio(const BINBUS::BUSW a) {
+	BUSW	v;
+
+	DBGPRINTF("BB-READIO(0x%08x)\n", a);
+	try {
+		readv(a, 0, 1, &v);
+	} catch(BUSERR b) {
+		DBGPRINTF("BB-READIO::BUSERR trying to read %08x\n", a);
+		throw BUSERR(a);
+	}
+
+	if (m_lastaddr != a) {
+		DBGPRINTF("LAST-ADDR MIS-MATCH: (RCVD) %08x != %08x (XPECTED)\n", m_lastaddr, a);
+		m_addr_set = false;
+
+		exit(EXIT_FAILURE);
+	}
+
+	return v;
+}
+
+/*
+ * encode_word
+ *
+ * Places the five byte payload for the 32-bit word v into the buffer at ptr,
+ * returning a pointer to the byte following.
+ */
+char	*BINBUS::encode_word(char *ptr, const BUSW v) {
+	*ptr++ = (v >> 28) & 0x0f;
+	*ptr++ = (v >> 21) & 0x7f;
+	*ptr++ = (v >> 14) & 0x7f;
+	*ptr++ = (v >>  7) & 0x7f;
+	*ptr++ =  v        & 0x7f;
+	return ptr;
+}
+
+/*
+ * encode_address
+ *
+ * Places a set address command into the buffer at ptr, returning a pointer
+ * to the character following, unless the bus is already set to the address
+ * we need.  As with the HEXBUS, the low order bit of the address is set if
+ * the address is not to increment.  Since every payload takes five bytes,
+ * there's nothing to be gained by sending an address difference.
+ */
+char	*BINBUS::encode_address(char *ptr, const BINBUS::BUSW a) {
+	if ((m_addr_set)&&((a&-4) == m_lastaddr)&&(m_inc == ((a&1)^1))) {
+		DBGPRINTF("Address is already set to %08x\n", a);
+		return ptr;
+	}
+
+	*ptr++ = BINB_ADDR;
+	ptr = encode_word(ptr, a & -3);
+
+	return ptr;
+}
+
+/*
+ * readv
+ *
+ * This is the main worker routine for read calls.  readio, readz, readi, all
+ * end up here.
+ *
+ * Parameters:
+ *	a	The address to start reading from
+ *	inc	'1' if we want to increment the address following each read,
+ *		'0' otherwise
+ *	len	The number of words to read
+ *	buf	A memory buffer storage location to place the results into
+ *
+ * As with the HEXBUS, up to m_rdwindow reads are kept in flight at any given
+ * time, topping the window off once it has drained by half.  Here, though,
+ * a single byte requests up to BINB_MAXBURST reads.
+ */
+void	BINBUS::readv(const BINBUS::BUSW a, const int inc, const int len, BINBUS::BUSW *buf) {
+	int	nread = 0, nsent = 0;
+	char	*ptr;
+
+	if (len <= 0)
+		return;
+	DBGPRINTF("BB-READV(%08x,%d,#%4d)\n", a, inc, len);
+
+	bufalloc(m_rdwindow + 16);
+	ptr = encode_address(m_buf, a | ((inc)?0:1));
+	m_lastaddr = a; m_addr_set = true; m_inc = inc;
+	try {
+	    while(nread < len) {
+		if ((nsent < len)&&((nsent - nread <= m_rdwindow/2)
+					||(nsent == nread))) {
+			while((nsent < len)&&(nsent - nread < m_rdwindow)) {
+				int	n = len - nsent;
+
+				if (n > m_rdwindow - (nsent - nread))
+					n = m_rdwindow - (nsent - nread);
+				if (n > BINB_MAXBURST)
+					n = BINB_MAXBURST;
+				*ptr++ = BINB_READ | (n-1);
+				nsent += n;
+			}
+
+			m_dev->write(m_buf, (ptr-m_buf));
+			DBGPRINTF("BB-READV: %d requests outstanding\n",
+				nsent - nread);
+			ptr = m_buf;
+		}
+
+		buf[nread++] = readword();
+	    }
+	} catch(BUSERR b) {
+		DBGPRINTF("BB-READV::BUSERR trying to read %08x\n", a+((inc)?(nread<<2):0));
+		m_addr_set = false;
+		flushreads(nsent - nread - 1);
+		throw BUSERR(a+((inc)?(nread<<2):0));
+	}
+
+	if ((unsigned)m_lastaddr != (a+((inc)?(len<<2):0))) {
+		printf("BINBUS::READV(a=%08x,inc=%d,len=%4x,x) ERR: (Last) %08x != %08x + %08x (Expected)\n", a, inc, len<<2, m_lastaddr, a, (inc)?(len<<2):0);
+		fflush(stdout);
+		exit(EXIT_FAILURE);
+	}
+
+	DBGPRINTF("BB-READV::COMPLETE, [%08x] -> %08x%s\n", a, buf[0],
+		(len>1)?", ...":"");
+}
+
+/*
+ * flushreads
+ *
+ * Following a bus error in the middle of a pipelined read, read and discard
+ * the responses to any requests that were still outstanding.
+ */
+void	BINBUS::flushreads(int count) {
+	DBGPRINTF("BB-FLUSH-READS(%d)\n", count);
+	while(count-- > 0) {
+		try {
+			readword();
+		} catch(BUSERR b) {
+			if (b.addr == 0)	// Interface went idle, abort
+				break;
+		}
+	}
+}
+
+/*
+ * readi
+ *
+ * Read a series of values from bus addresses starting at address a,
+ * incrementing the address to read from subsequent addresses along the way.
+ */
+void	BINBUS::readi(const BINBUS::BUSW a, const int len, BINBUS::BUSW *buf) {
+	readv(a, 1, len, buf);
+}
+
+/*
+ * readz
+ *
+ * Read a series of values from the bus, with all the values coming from the
+ * same address: a.
+ */
+void	BINBUS::readz(const BINBUS::BUSW a, const int len, BINBUS::BUSW *buf) {
+	readv(a, 0, len, buf);
+}
+
+/*
+ * runv
+ *
+ * Runs a list of transactions, keeping as many of their reads and writes in
+ * flight at once as our windows allow, just as HEXBUS::runv() does.  Each
+ * transaction starts with an absolute address, followed by read and write
+ * commands of up to BINB_MAXBURST words each.
+ */
+void	BINBUS::runv(const int n, BUSTRANS *t) {
+	int	ti = 0, wi = 0;	// The transaction and word to issue next
+	int	tc = 0, wc = 0;	// The transaction and word to collect next
+	int	nrd = 0, nwr = 0;	// The reads and writes outstanding
+	const int	full = m_rdwindow * m_wrwindow;
+	unsigned	nacks = 0;
+	char	*ptr;
+
+	DBGPRINTF("BB-RUNV(#%d)\n", n);
+	for(int k=0; k<n; k++)
+		t[k].m_err = false;
+
+	// An address or write takes at most six bytes, a read one for every
+	// burst.  Allow for one address per word outstanding.
+	bufalloc(12*(m_rdwindow + m_wrwindow) + 16);
+	m_nacks = 0;
+	while(tc < n) {
+		if ((ti < n)&&((nrd+nwr == 0)
+			||(2*(nrd*m_wrwindow + nwr*m_rdwindow) <= full))) {
+			ptr = m_buf;
+			while(ti < n) {
+				BUSTRANS	*p = &t[ti];
+				int	room, nw = p->m_len - wi;
+
+				if (p->m_len <= 0) {
+					ti++;
+					continue;
+				}
+
+				room = full - nrd*m_wrwindow - nwr*m_rdwindow;
+				room /= (p->m_write) ? m_rdwindow : m_wrwindow;
+				if (nw > room)
+					nw = room;
+				if (nw <= 0)
+					break;
+
+				if (wi == 0) {
+					m_addr_set = false;
+					ptr = encode_address(ptr,
+						p->m_addr|((p->m_inc)?0:1));
+				}
+
+				for(int k=0; k<nw; ) {
+					int	nb = nw - k;
+
+					if (nb > BINB_MAXBURST)
+						nb = BINB_MAXBURST;
+					if (p->m_write) {
+						*ptr++ = BINB_WRITE | (nb-1);
+						for(int j=0; j<nb; j++)
+							ptr = encode_word(ptr,
+								p->m_buf[wi+k+j]);
+					} else
+						*ptr++ = BINB_READ | (nb-1);
+					k += nb;
+				}
+
+				if (p->m_write)
+					nwr += nw;
+				else
+					nrd += nw;
+				wi += nw;
+				if (wi >= p->m_len) {
+					ti++;
+					wi = 0;
+				}
+			}
+
+			m_dev->write(m_buf, ptr-m_buf);
+			DBGPRINTF("BB-RUNV: %d reads, %d writes outstanding\n",
+				nrd, nwr);
+		}
+
+		// Collect the response to the next word outstanding
+		BUSTRANS	*p = &t[tc];
+		if (wc >= p->m_len) {
+			tc++;
+			wc = 0;
+			continue;
+		}
+
+		try {
+			if (p->m_write) {
+				while(m_nacks < nacks+1)
+					readword(true);
+				nacks++;
+			} else
+				p->m_buf[wc] = readword();
+		} catch(BUSERR b) {
+			BUSW	erraddr = p->m_addr + ((p->m_inc)?(wc<<2):0);
+
+			DBGPRINTF("BB-RUNV::BUSERR at %08x\n", erraddr);
+			if (!p->m_err) {
+				p->m_err = true;
+				p->m_erraddr = erraddr;
+			}
+
+			if (b.addr == 0) {
+				for(int k=tc+1; k<n; k++) {
+					t[k].m_err = true;
+					t[k].m_erraddr = t[k].m_addr;
+				} break;
+			}
+		}
+
+		if (p->m_write)
+			nwr--;
+		else
+			nrd--;
+		wc++;
+	}
+
+	m_addr_set = false;
+}
+
+/*
+ * readrsp
+ *
+ * Decode the incoming byte stream, returning the first byte of the next
+ * complete response.  Read data and addresses are left in m_rspword.  If
+ * block is false, we return -1 rather than wait on a response that hasn't
+ * (completely) arrived yet.  Any partial response is kept for the next call.
+ */
+int	BINBUS::readrsp(const bool block) {
+	char	ch;
+
+	while((block)||(m_dev->available())) {
+		if (lclreadcode(&ch, 1) < 1)
+			continue;
+
+		if (m_rsplen == 0) {
+			// The first byte of a new response
+			m_rsp = ch;
+			if ((ch & 0x60) == 0) {
+				// Read data, or an address.  Four more
+				// bytes to come.
+				m_rspword = ch & 0x0f;
+				m_rsplen = 4;
+				continue;
+			} return m_rsp;
+		}
+
+		if (m_esc) {
+			ch = BINB_ESCAPE | (ch & 1);
+			m_esc = false;
+		} else if (ch == BINB_ESCAPE) {
+			m_esc = true;
+			continue;
+		}
+
+		m_rspword = (m_rspword << 7) | ((ch ^ BINB_SCRAMBLE) & 0x7f);
+		if (--m_rsplen == 0)
+			return m_rsp;
+	}
+
+	return -1;
+}
+
+/*
+ * process
+ *
+ * Update our state given a response returned from readrsp().  Returns true
+ * if the response was read data, and throws a BUSERR on any bus error.
+ */
+bool	BINBUS::process(int rsp) {
+	switch((rsp >> 4)&7) {
+	case BINB_RSPDATA:
+		if (m_inc)
+			m_lastaddr += 4;
+		return true;
+	case BINB_RSPADDR:
+		m_addr_set  = true;
+		m_inc       = (m_rspword & 1) ? 0:1;
+		m_lastaddr  = m_rspword & -4;
+		DBGPRINTF("RCVD ADDR: 0x%08x%s\n", m_lastaddr,
+			(m_inc)?" INC":"");
+		break;
+	case BINB_RSPACK: {
+		unsigned	n = (rsp & 0x0f) + 1;
+
+		if (m_inc)
+			m_lastaddr += (n << 2);
+		m_nacks += n;
+		} break;
+	case BINB_RSPSPECIAL:
+		switch(rsp & 7) {
+		case BINB_SPCRESET:
+			DBGPRINTF("BUS RESET\n");
+			m_addr_set = false;
+			m_bus_err = false;
+			break;
+		case BINB_SPCERR:
+			DBGPRINTF("Bus error(%08x)\n", m_lastaddr);
+			m_bus_err = true;
+			throw BUSERR(m_lastaddr);
+		case BINB_SPCINT:
+			m_interrupt_flag = true;
+			break;
+		default: // Idle
+			break;
+		} break;
+	default:
+		DBGPRINTF("Unknown response, %02x\n", rsp);
+		break;
+	}
+
+	return false;
+}
+
+/*
+ * readword()
+ *
+ * Once the read command has been issued, readword() is called to read each
+ * word's response from the bus.  Any other responses, such as interrupts
+ * or bus errors, are processed along the way.  If ack is set, we also return
+ * after any (coalesced) write acknowledgement.
+ */
+BINBUS::BUSW	BINBUS::readword(const bool ack) {
+	int		rsp;
+	unsigned	abort_countdown = 3;
+
+	while(1) {
+		rsp = readrsp(true);
+		if (rsp == ((BINB_RSPSPECIAL<<4)|BINB_SPCIDLE)) {
+			abort_countdown--;
+			if (0 == abort_countdown) {
+				DBGPRINTF("Bus error(0x%08x,ABORT)\n",
+					m_lastaddr);
+				throw BUSERR(0);
+			}
+		} else if (process(rsp))
+			return m_rspword;
+		else if ((ack)&&(((rsp >> 4)&7) == BINB_RSPACK))
+			return 0;
+	}
+}
+
+/*
+ * readidle()
+ *
+ * Process any responses that have already arrived, without waiting on any
+ * more.  Read data isn't expected here, and so it is ignored.
+ */
+void	BINBUS::readidle(void) {
+	int	rsp;
+
+	while((rsp = readrsp(false)) >= 0)
+		process(rsp);
+}
+
+/*
+ * usleep()
+ *
+ * Called to implement some form of time-limited wait on a response from the
+ * bus.
+ */
+void	BINBUS::usleep(unsigned ms) {
+	if (m_dev->poll(ms)) {
+		try {
+			readidle();
+		} catch(BUSERR b) {
+			// m_bus_err is already set
+		}
+	}
+}
+
+/*
+ * wait()
+ *
+ * Wait for an interrupt condition.
+ */
+void	BINBUS::wait(void) {
+	if (m_interrupt_flag)
+		DBGPRINTF("INTERRUPTED PRIOR TO WAIT()\n");
+	do {
+		usleep(200);
+	} while(!m_interrupt_flag);
+}
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	binbus.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	This is the C++ program on the command side that will interact
+//		with the binary framed debugging bus on an FPGA (rtl/binbus),
+//	to command the WISHBONE on that same FPGA to ... whatever we wish to
+//	command it to do.  It is a drop in replacement for the HEXBUS, packing
+//	each 32-bit word into five 7-bit bytes rather than up to ten ASCII
+//	characters.
+//
+//	This code does not run on an FPGA, is not a test bench, neither
+//	is it a simulator.  It is a portion of a command program
+//	for commanding an FPGA.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+//
+#ifndef	BINBUS_H
+#define	BINBUS_H
+
+#include "llcomms.h"
+#include "devbus.h"
+
+// The maximum number of words we can read or write with a single command
+#define	BINB_MAXBURST	16
+
+// The number of reads we'll keep in flight at once.  Since each burst of
+// up to BINB_MAXBURST reads only takes one slot in the command FIFO (hbfifo)
+// within the RTL, this can be much larger than the HEXBUS read window.
+#ifndef	BINB_RDWINDOW
+#define	BINB_RDWINDOW	64
+#endif
+
+// The number of writes we'll allow to be unacknowledged at once.  Every
+// write takes a slot in the command FIFO, so this can be no more than its
+// depth.
+#ifndef	BINB_WRWINDOW
+#define	BINB_WRWINDOW	16
+#endif
+
+// How long (in ms) to wait on the device for any write acknowledgements
+#define	BINB_ACKTIMEOUT	20
+
+class	BINBUS : public DEVBUS {
+public:
+	unsigned long	m_total_nread;
+private:
+	LLCOMMSI	*m_dev;
+
+	bool	m_interrupt_flag, m_addr_set, m_bus_err;
+	unsigned int	m_lastaddr, m_nacks;
+	bool		m_inc;
+
+	// Response decoding state.  m_rsp is the first byte of the response
+	// being decoded, m_rsplen the number of bytes of it still to come
+	bool		m_esc;
+	int		m_rsp, m_rsplen;
+	unsigned	m_rspword;
+
+	int	m_buflen, m_rdwindow, m_wrwindow;
+	char	*m_buf;
+
+	void	init(void) {
+		m_total_nread = 0;
+		m_interrupt_flag = false;
+		m_buflen = 0; m_buf = NULL;
+		m_addr_set = false;
+		bufalloc(64);
+		m_bus_err    = false;
+		m_nacks = 0;
+		m_esc = false;
+		m_rsp = -1; m_rsplen = 0; m_rspword = 0;
+		m_rdwindow = BINB_RDWINDOW;
+		m_wrwindow = BINB_WRWINDOW;
+	}
+
+	void	bufalloc(int len);
+	BUSW	readword(const bool ack = false); // Reads a word from the bus
+	void	readv(const BUSW a, const int inc, const int len, BUSW *buf);
+	void	writev(const BUSW a, const int p, const int len, const BUSW *buf);
+	void	readidle(void);
+	void	flushreads(int count);
+	void	waitacks(unsigned nacks);
+	void	flushacks(int count);
+
+	int	lclreadcode(char *buf, int len);
+	int	readrsp(const bool block);
+	bool	process(int rsp);
+	char	*encode_word(char *ptr, const BUSW v);
+	char	*encode_address(char *ptr, const BUSW a);
+public:
+	BINBUS(LLCOMMSI *comms) : m_dev(comms) { init(); }
+	virtual	~BINBUS(void) {
+		m_dev->close();
+		if (m_buf)
+			delete[] m_buf;
+		m_buf = NULL;
+		delete	m_dev;
+	}
+
+	void	kill(void) { m_dev->close(); }
+	void	close(void) {	m_dev->close(); }
+	void	writeio(const BUSW a, const BUSW v);
+	BUSW	readio(const BUSW a);
+	void	readi( const BUSW a, const int len, BUSW *buf);
+	void	readz( const BUSW a, const int len, BUSW *buf);
+	void	writei(const BUSW a, const int len, const BUSW *buf);
+	void	writez(const BUSW a, const int len, const BUSW *buf);
+	bool	poll(void) { return m_interrupt_flag; };
+	void	usleep(unsigned msec); // Sleep until interrupt
+	void	wait(void); // Sleep until interrupt
+	bool	bus_err(void) const { return m_bus_err; };
+	void	reset_err(void) { m_bus_err = false; }
+	void	clear(void) { m_interrupt_flag = false; }
+
+	// Run a list of transactions, several at a time
+	void	runv(const int n, BUSTRANS *t);
+
+	// Reset the bus within the FPGA, wherever it may be in decoding a
+	// command
+	void	reset(void);
+
+	// Set the maximum number of reads that may be outstanding at any
+	// one time
+	void	readwindow(int w) { m_rdwindow = (w < 1) ? 1 : w; }
+	int	readwindow(void) const { return m_rdwindow; }
+
+	// Set the maximum number of writes that may be unacknowledged at any
+	// one time.  This is bounded by the depth of the command FIFO within
+	// the RTL.
+	void	writewindow(int w) { m_wrwindow = (w < 1) ? 1 : w; }
+	int	writewindow(void) const { return m_wrwindow; }
+};
+
+#endif
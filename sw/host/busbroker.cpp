@@ -0,0 +1,449 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	busbroker.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Holds one long-lived connection to the FPGA's debugging bus
+//		(through netpport), and shares it with any number of clients
+//	connected to a UNIX-domain socket.  This saves every wbregs, zipload,
+//	etc. from connecting to (and tearing down) its own connection, and
+//	allows more than one such program to use the bus at a time.
+//
+//	To its clients, the broker looks like a hexbus.  Each client's
+//	commands are decoded, run on the FPGA, and then answered as the hexbus
+//	would have answered them.  The broker keeps each client's bus address
+//	separately, so clients can't disturb one another.  Clients are served
+//	in turn, each taking whatever commands it has sent at once.  Those
+//	commands are then run together through DEVBUS::runv(), so that they
+//	are pipelined on the link to the FPGA however the client sent them.
+//
+//	Usage:	busbroker [-n host] [-p port] [-s path]
+//
+//	Then, for example,
+//
+//		wbregs -n /tmp/catzip-bus version
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "port.h"
+#include "llcomms.h"
+#include "hexbus.h"
+
+// Our clients speak hexbus to us, and so must be built with DBGBUS=hexbus.
+// Were we built otherwise, our own connection to the FPGA would work, but
+// theirs, to us, would not.
+#if	defined(BINBUS_MASTER) || defined(WBU_MASTER)
+#error	"busbroker only speaks hexbus: build it with DBGBUS=hexbus"
+#endif
+
+// The most clients we'll serve at once
+#define	BROKER_MAXCLIENTS	16
+
+// The most commands we'll take from any one client before running them
+#define	BROKER_MAXCMDS		1024
+
+// How long (in ms) to wait on our clients before checking the FPGA for
+// interrupts
+#define	BROKER_POLLTIME		20
+
+FPGA	*m_fpga;
+
+/*
+ * BROKERCLIENT
+ *
+ * The state of one client: its connection, where it is in decoding its
+ * commands, and where its bus address is.
+ */
+class	BROKERCLIENT {
+public:
+	int	m_fd;
+
+	// Command decoding.  m_cmd is the command whose payload is being
+	// received, m_word that payload so far.
+	int		m_cmd;
+	unsigned	m_word;
+	bool		m_first;
+
+	// This client's bus address, and whether or not it increments
+	unsigned	m_addr;
+	bool		m_inc;
+
+	// Commands decoded, but not yet run
+	int		m_ncmds;
+	char		m_cmds[BROKER_MAXCMDS];
+	DEVBUS::BUSW	m_data[BROKER_MAXCMDS];
+	bool		m_err[BROKER_MAXCMDS];
+
+	BROKERCLIENT(int fd) : m_fd(fd) {
+		m_cmd = 0; m_word = 0; m_first = false;
+		m_addr = 0; m_inc = true;
+		m_ncmds = 0;
+	}
+
+	void	decode(const char *buf, int len);
+	void	run(void);
+	void	send(const char *buf, int len);
+};
+
+/*
+ * send
+ *
+ * Send our responses back to the client.  Should the client have gone away,
+ * we'll find out when we next try to read from it.
+ */
+void	BROKERCLIENT::send(const char *buf, int len) {
+	int	pos = 0, nw;
+
+	while(pos < len) {
+		nw = ::write(m_fd, &buf[pos], len-pos);
+		if ((nw < 0)&&(errno == EINTR))
+			continue;
+		else if (nw <= 0)
+			return;
+		pos += nw;
+	}
+}
+
+/*
+ * decode
+ *
+ * Decode the hexbus commands within buf.  Much like hbpack within the RTL,
+ * hexadecimal digits make up the payload of the command before them, and the
+ * first digit of an address is sign extended.  A command is complete once
+ * the next non-digit arrives.  Anything other than a command (such as the
+ * newline ending a batch) just completes whatever came before it.
+ */
+void	BROKERCLIENT::decode(const char *buf, int len) {
+	for(int i=0; i<len; i++) {
+		char	ch = buf[i] & 0x7f;
+		int	d = -1;
+
+		if ((ch >= '0')&&(ch <= '9'))
+			d = ch - '0';
+		else if ((ch >= 'a')&&(ch <= 'f'))
+			d = ch - 'a' + 10;
+
+		if (d >= 0) {
+			if ((m_first)&&(m_cmd == 'A'))
+				m_word = (d & 8) ? (0xfffffff0u | d) : d;
+			else
+				m_word = (m_word << 4) | d;
+			m_first = false;
+			continue;
+		}
+
+		if (m_cmd) {
+			m_cmds[m_ncmds] = m_cmd;
+			m_data[m_ncmds] = m_word;
+			if (++m_ncmds >= BROKER_MAXCMDS)
+				run();
+		}
+
+		if ((ch == 'A')||(ch == 'R')||(ch == 'W')||(ch == 'T'))
+			m_cmd = ch;
+		else
+			m_cmd = 0;
+		m_word = 0;
+		m_first = true;
+	}
+}
+
+/*
+ * run
+ *
+ * Run all of the commands we've decoded on the FPGA, and answer each of
+ * them.  Consecutive reads (or writes) become a single transaction, and all
+ * of the transactions are handed to runv() at once.
+ */
+void	BROKERCLIENT::run(void) {
+	BUSTRANS	trans[BROKER_MAXCMDS];
+	int		ntrans = 0, first[BROKER_MAXCMDS];
+	unsigned	addr = m_addr;
+	bool		inc = m_inc;
+	char		*rsp, *ptr;
+
+	if (m_ncmds == 0)
+		return;
+
+	for(int k=0; k<m_ncmds; k++) {
+		BUSTRANS	*t;
+
+		m_err[k] = false;
+		if (m_cmds[k] == 'A') {
+			if (m_data[k] & 2)
+				addr += m_data[k] & -4;
+			else
+				addr = m_data[k] & -4;
+			inc = (m_data[k] & 1) ? false : true;
+			continue;
+		} else if (m_cmds[k] == 'T')
+			continue;
+
+		// Extend the last transaction if this is just more of the same
+		if ((k > 0)&&(m_cmds[k-1] == m_cmds[k]))
+			trans[ntrans-1].m_len++;
+		else {
+			t = &trans[ntrans];
+			first[ntrans++] = k;
+			t->m_write = (m_cmds[k] == 'W');
+			t->m_inc   = inc;
+			t->m_addr  = addr;
+			t->m_len   = 1;
+			t->m_buf   = &m_data[k];
+		}
+
+		if (inc)
+			addr += 4;
+	}
+
+	m_fpga->runv(ntrans, trans);
+
+	// Mark every word of a failed transaction from the one that failed
+	// onwards.  We can't tell which word failed within a transaction that
+	// doesn't increment its address, so there we fail them all.
+	for(int t=0; t<ntrans; t++) {
+		int	e;
+
+		if (!trans[t].m_err)
+			continue;
+		e = 0;
+		if (trans[t].m_inc)
+			e = (trans[t].m_erraddr - trans[t].m_addr) >> 2;
+		if ((e < 0)||(e >= trans[t].m_len))
+			e = 0;
+		for(int k=e; k<trans[t].m_len; k++)
+			m_err[first[t]+k] = true;
+	}
+
+	// Now answer every command, in order, as the hexbus would
+	ptr = rsp = new char[12*m_ncmds+2];
+	for(int k=0; k<m_ncmds; k++) {
+		switch(m_cmds[k]) {
+		case 'A':
+			if (m_data[k] & 2)
+				m_addr += m_data[k] & -4;
+			else
+				m_addr = m_data[k] & -4;
+			m_inc = (m_data[k] & 1) ? false : true;
+			ptr += sprintf(ptr, "A%x\n", m_addr | ((m_inc)?0:1));
+			continue;
+		case 'T':
+			ptr += sprintf(ptr, "T\n");
+			continue;
+		case 'R':
+			if (m_err[k])
+				ptr += sprintf(ptr, "E\n");
+			else
+				ptr += sprintf(ptr, "R%x\n", m_data[k]);
+			break;
+		default:
+			ptr += sprintf(ptr, (m_err[k]) ? "E\n" : "K\n");
+			break;
+		}
+
+		if (m_inc)
+			m_addr += 4;
+	}
+
+	send(rsp, ptr-rsp);
+	delete[] rsp;
+	m_ncmds = 0;
+}
+
+/*
+ * setup_listener
+ *
+ * Create the UNIX-domain socket our clients will connect to, replacing any
+ * left behind by a prior broker.
+ */
+int	setup_listener(const char *path) {
+	int	skt;
+	struct	sockaddr_un	my_addr;
+
+	printf("Listening on %s\n", path);
+
+	skt = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (skt < 0) {
+		perror("Could not allocate socket: ");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(&my_addr, 0, sizeof(my_addr));
+	my_addr.sun_family = AF_UNIX;
+	strncpy(my_addr.sun_path, path, sizeof(my_addr.sun_path)-1);
+
+	unlink(path);
+	if (bind(skt, (struct sockaddr *)&my_addr, sizeof(my_addr))!=0) {
+		perror("BIND FAILED:");
+		exit(EXIT_FAILURE);
+	}
+
+	if (listen(skt, BROKER_MAXCLIENTS) != 0) {
+		perror("Listen failed:");
+		exit(EXIT_FAILURE);
+	}
+
+	return skt;
+}
+
+const char	*gbl_path = BROKERPATH;
+
+void	closeup(int v) {
+	unlink(gbl_path);
+	exit(EXIT_SUCCESS);
+}
+
+void	usage(void) {
+	printf("USAGE: busbroker [-n host] [-p port] [-s path]\n"
+"\n"
+"\tShares one connection to the FPGA, at host:port, with any number of\n"
+"\tclients connecting to the UNIX-domain socket at path.  Both it and\n"
+"\tits clients speak hexbus, so all must be built with DBGBUS=hexbus.\n"
+"\n"
+"\t-n host\tThe network host netpport is running on [%s]\n"
+"\t-p port\tThe port netpport is listening on [%d]\n"
+"\t-s path\tWhere our clients may find us [%s]\n",
+		FPGAHOST, FPGAPORT, BROKERPATH);
+}
+
+int main(int argc, char **argv) {
+	const char	*host = FPGAHOST;
+	int		port = FPGAPORT, opt, skt, nclients = 0;
+	BROKERCLIENT	*clients[BROKER_MAXCLIENTS];
+
+	while((opt = getopt(argc, argv, "hn:p:s:")) != -1) {
+		switch(opt) {
+		case 'n': host = optarg; break;
+		case 'p': port = strtoul(optarg, NULL, 0); break;
+		case 's': gbl_path = optarg; break;
+		default:
+			usage();
+			exit((opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+
+	if (host[0] == '/') {
+		fprintf(stderr, "ERR: The broker can't connect to a broker\n");
+		exit(EXIT_FAILURE);
+	}
+
+	m_fpga = new FPGA(new NETCOMMS(host, port));
+
+	// A client going away shouldn't take us with it
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT,  closeup);
+	signal(SIGTERM, closeup);
+
+	skt = setup_listener(gbl_path);
+
+	while(1) {
+		struct	pollfd	p[BROKER_MAXCLIENTS+1];
+		int	nfds = 0;
+
+		for(int k=0; k<nclients; k++) {
+			p[nfds].fd = clients[k]->m_fd;
+			p[nfds].events = POLLIN;
+			nfds++;
+		}
+
+		if (nclients < BROKER_MAXCLIENTS) {
+			p[nfds].fd = skt;
+			p[nfds].events = POLLIN;
+			nfds++;
+		}
+
+		if (poll(p, nfds, BROKER_POLLTIME) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("Poll Failed!  O/S Err:");
+			exit(EXIT_FAILURE);
+		}
+
+		// Serve each client with commands waiting, in turn
+		for(int k=0; k<nclients; k++) {
+			char	buf[4096];
+			int	nr;
+
+			if (0 == (p[k].revents & (POLLIN|POLLHUP|POLLERR)))
+				continue;
+
+			nr = ::read(clients[k]->m_fd, buf, sizeof(buf));
+			if (nr <= 0) {
+				// This client has closed its connection
+				::close(clients[k]->m_fd);
+				delete clients[k];
+				clients[k] = NULL;
+				continue;
+			}
+
+			clients[k]->decode(buf, nr);
+			clients[k]->run();
+		}
+
+		// Remove any clients that have left us
+		{
+			int	n = 0;
+			for(int k=0; k<nclients; k++)
+				if (clients[k])
+					clients[n++] = clients[k];
+			nclients = n;
+		}
+
+		if ((nfds > 0)&&(p[nfds-1].fd == skt)
+				&&(p[nfds-1].revents & POLLIN)) {
+			int	fd = ::accept(skt, 0, 0);
+
+			if (fd >= 0)
+				clients[nclients++] = new BROKERCLIENT(fd);
+		}
+
+		// Pass any interrupts from the FPGA on to everyone
+		m_fpga->usleep(0);
+		if (m_fpga->poll()) {
+			m_fpga->clear();
+			for(int k=0; k<nclients; k++)
+				clients[k]->send("I\n", 2);
+		}
+	}
+
+	return 0;
+}
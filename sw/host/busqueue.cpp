@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	busqueue.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Queues transactions for any DEVBUS, handing them to
+//		DEVBUS::runv() in batches so that many may be in flight at
+//	once.  See busqueue.h for how to use it.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "busqueue.h"
+
+BUSQUEUE::BUSQUEUE(DEVBUS *bus, unsigned sz) : m_bus(bus) {
+	// Round the size up to the next power of two
+	for(m_size = 1; m_size < sz; m_size <<= 1)
+		;
+	m_trans = new BUSTRANS[m_size];
+	m_word  = new BUSW[m_size];
+	m_next = m_pending = 0;
+}
+
+BUSQUEUE::~BUSQUEUE(void) {
+	flush();
+	delete[] m_trans;
+	delete[] m_word;
+}
+
+/*
+ * submit
+ *
+ * Place a transaction into the next slot of the ring, running whatever is
+ * pending first if the ring is full.  A NULL buf means the transaction is a
+ * single word, to be kept in the slot's own word.
+ */
+BUSQUEUE::HANDLE	BUSQUEUE::submit(bool wr, bool inc, BUSW a, int len,
+		BUSW *buf) {
+	HANDLE		h;
+	BUSTRANS	*t;
+
+	if (m_next - m_pending >= m_size)
+		flush();
+
+	h = m_next++;
+	t = &slot(h);
+	t->m_write = wr;
+	t->m_inc   = inc;
+	t->m_addr  = a;
+	t->m_len   = len;
+	t->m_buf   = (buf) ? buf : &m_word[h & (m_size-1)];
+	t->m_err   = false;
+	t->m_erraddr = 0;
+
+	return h;
+}
+
+BUSQUEUE::HANDLE	BUSQUEUE::readio(const BUSW a) {
+	return submit(false, false, a, 1, NULL);
+}
+
+BUSQUEUE::HANDLE	BUSQUEUE::writeio(const BUSW a, const BUSW v) {
+	HANDLE	h = submit(true, false, a, 1, NULL);
+
+	slot(h).m_buf[0] = v;
+	return h;
+}
+
+BUSQUEUE::HANDLE	BUSQUEUE::readi(const BUSW a, const int len, BUSW *buf) {
+	return submit(false, true, a, len, buf);
+}
+
+BUSQUEUE::HANDLE	BUSQUEUE::readz(const BUSW a, const int len, BUSW *buf) {
+	return submit(false, false, a, len, buf);
+}
+
+// runv() never writes through the buffer of a write, so casting away the
+// const is safe here
+BUSQUEUE::HANDLE	BUSQUEUE::writei(const BUSW a, const int len,
+		const BUSW *buf) {
+	return submit(true, true, a, len, (BUSW *)buf);
+}
+
+BUSQUEUE::HANDLE	BUSQUEUE::writez(const BUSW a, const int len,
+		const BUSW *buf) {
+	return submit(true, false, a, len, (BUSW *)buf);
+}
+
+/*
+ * flush
+ *
+ * Run all of the transactions pending.  Since these sit within a ring, this
+ * takes two calls to runv() whenever they wrap around its end.
+ */
+void	BUSQUEUE::flush(void) {
+	while(m_pending != m_next) {
+		unsigned	first = m_pending & (m_size-1);
+		unsigned	n = m_next - m_pending;
+
+		if (first + n > m_size)
+			n = m_size - first;
+		m_bus->runv(n, &m_trans[first]);
+		m_pending += n;
+	}
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	busqueue.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	An asynchronous layer on top of any DEVBUS.  Rather than
+//		waiting on every read or write in turn, reads, writes, and
+//	bursts are queued, returning a handle.  The queue is then run through
+//	DEVBUS::runv() all at once, so that the debugging bus can keep many of
+//	these transactions in flight at the same time.  Results come back in
+//	the order the transactions were queued.
+//
+//	For example,
+//
+//		BUSQUEUE	q(m_fpga);
+//		BUSQUEUE::HANDLE	hs, hd;
+//
+//		hs = q.readio(R_ZIPCTRL);
+//		hd = q.readi(RAMBASE, len, buf);
+//		q.flush();	// Or q.wait(hd)
+//		if (!q.err(hs))
+//			printf("CPU: %08x\n", q.value(hs));
+//
+//	Buffers handed to readi(), readz(), writei() and writez() must remain
+//	valid until their transaction completes.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	BUSQUEUE_H
+#define	BUSQUEUE_H
+
+#include "devbus.h"
+
+// The default number of transactions we'll queue before running them
+#define	BUSQ_DEFAULTSZ	64
+
+class	BUSQUEUE {
+public:
+	typedef	DEVBUS::BUSW	BUSW;
+	typedef	unsigned	HANDLE;
+private:
+	DEVBUS		*m_bus;
+
+	// A ring of m_size (a power of two) transactions, and a word for each
+	// to hold the value of any single read or write.  m_next is the
+	// handle the next transaction will be given, m_pending that of the
+	// first transaction not yet run.
+	BUSTRANS	*m_trans;
+	BUSW		*m_word;
+	unsigned	m_size;
+	HANDLE		m_next, m_pending;
+
+	HANDLE	submit(bool wr, bool inc, BUSW a, int len, BUSW *buf);
+	BUSTRANS	&slot(HANDLE h) const { return m_trans[h & (m_size-1)]; }
+public:
+	BUSQUEUE(DEVBUS *bus, unsigned sz = BUSQ_DEFAULTSZ);
+	~BUSQUEUE(void);
+
+	// Queue a single read or write, whose value is kept by the queue
+	HANDLE	readio(const BUSW a);
+	HANDLE	writeio(const BUSW a, const BUSW v);
+
+	// Queue a burst, using the caller's buffer
+	HANDLE	readi( const BUSW a, const int len, BUSW *buf);
+	HANDLE	readz( const BUSW a, const int len, BUSW *buf);
+	HANDLE	writei(const BUSW a, const int len, const BUSW *buf);
+	HANDLE	writez(const BUSW a, const int len, const BUSW *buf);
+
+	// Run everything queued so far
+	void	flush(void);
+
+	// True once the transaction h has been run
+	bool	done(const HANDLE h) const { return (int)(h - m_pending) < 0; }
+
+	// Block until the transaction h has been run
+	void	wait(const HANDLE h) { if (!done(h)) flush(); }
+
+	// The results of a transaction.  These are only valid once the
+	// transaction is done, and only for the last m_size transactions
+	// submitted.  value() returns the word read or written by readio()
+	// or writeio(), or the first word of a burst.
+	BUSW	value(const HANDLE h) const { return slot(h).m_buf[0]; }
+	bool	err(const HANDLE h) const { return slot(h).m_err; }
+	BUSW	erraddr(const HANDLE h) const { return slot(h).m_erraddr; }
+
+	// The number of transactions queued but not yet run
+	unsigned	pending(void) const { return m_next - m_pending; }
+};
+
+#endif
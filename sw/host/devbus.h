@@ -60,6 +60,19 @@ public:
 	BUSERR(const uint32 a) : addr(a) {};
 };
 
+// A single bus transaction, one of many that may be handed to DEVBUS::runv()
+// at once
+class	BUSTRANS {
+public:
+	bool	m_write;	// True to write, false to read
+	bool	m_inc;		// True to increment the address after every word
+	uint32	m_addr;		// The first address to read from or write to
+	int	m_len;		// The number of words to read or write
+	uint32	*m_buf;		// Where to find (write) or place (read) the words
+	bool	m_err;		// Set by runv() if the transaction failed, ...
+	uint32	m_erraddr;	// ... in which case this is the address that did
+};
+
 class	DEVBUS {
 public:
 	typedef	uint32	BUSW;
@@ -142,6 +155,30 @@ public:
 	// the interface, does not check for further interrupt
 	virtual	void	clear(void) = 0;
 
+	// Run a list of n transactions, in order.  Rather than throwing a
+	// BUSERR, any transaction that fails is marked as having failed and
+	// the rest are still run.  This default simply runs them one at a
+	// time.  Implementations that can keep several transactions in flight
+	// at once should override it.
+	virtual	void	runv(const int n, BUSTRANS *t) {
+		for(int k=0; k<n; k++) {
+			t[k].m_err = false;
+			try {
+				if ((t[k].m_write)&&(t[k].m_inc))
+					writei(t[k].m_addr, t[k].m_len, t[k].m_buf);
+				else if (t[k].m_write)
+					writez(t[k].m_addr, t[k].m_len, t[k].m_buf);
+				else if (t[k].m_inc)
+					readi(t[k].m_addr, t[k].m_len, t[k].m_buf);
+				else
+					readz(t[k].m_addr, t[k].m_len, t[k].m_buf);
+			} catch(BUSERR b) {
+				t[k].m_err = true;
+				t[k].m_erraddr = b.addr;
+			}
+		}
+	}
+
 	virtual	~DEVBUS(void) { };
 };
 
@@ -127,20 +127,15 @@ void	filedump(const char *fmt, ...) {
  * set) from any interaction.
  */
 int	HEXBUS::lclreadcode(char *buf, int len) {
-	char	*sp, *dp;
-	int	nr, ret;
+	int	nr, nv = 0;
 
 	nr = m_dev->read(buf, len);
 	m_total_nread += nr;
-	ret = nr; sp = buf; dp = buf;
 	for(int i=0; i<nr; i++) {
-		if ((buf[i]&0x7f)==0x7f) {
-			// Idle insert, not a valid code word, skip it
-			sp++;
-		} else {
-			*sp++ = *dp++;
-		}
-	} return ret;
+		// Skip any idle inserts, they aren't valid code words
+		if ((buf[i]&0x7f)!=0x7f)
+			buf[nv++] = buf[i];
+	} return nv;
 }
 
 /*
@@ -183,6 +178,14 @@ void	HEXBUS::writeio(const BUSW a, const BUSW v) {
  *	len	The number of values to write to the bus
  *	buf	A memory pointer to the information to write
  *
+ * Writes are sent in batches, each a single call to m_dev->write(), with up
+ * to m_wrwindow writes allowed to be unacknowledged at any time.  Any
+ * acknowledgements that have arrived are collected (by readidle()) between
+ * batches, and we only block once the window is full.  Every write generates
+ * exactly one response, either an acknowledgement or a bus error, and these
+ * arrive in order.  Hence, the number of acknowledgements received prior to
+ * any bus error tells us exactly which address failed.
+ *
  * Notice that this routine can only write complete 32-bit words.  It doesn't
  * really have any 8-bit byte support, although you might be able to create such
  * by readio()'ing a word, modifying it, and then calling writeio() to write the
@@ -193,41 +196,108 @@ void	HEXBUS::writev(const BUSW a, const int p, const int len,
 	char	*ptr;
 	unsigned	nw = 0;
 
+	if (len <= 0)
+		return;
 	DBGPRINTF("WRITEV(%08x,%d,#%d,0x%08x ...)\n", a, p, len, buf[0]);
 
+	// Each write takes at most 9 characters: a 'W' and eight hex digits
+	bufalloc(9*m_wrwindow + 16);
+
 	// Encode the address
-	ptr = encode_address(a|((p)?0:1));
-	m_lastaddr = a; m_addr_set = true;
+	ptr = encode_address(m_buf, a|((p)?0:1));
+	m_lastaddr = a; m_addr_set = true; m_inc = p;
 	m_nacks = 0;
 
-	while(nw < (unsigned)len) {
-		*ptr++ = 'W'; *ptr = '\0';
-		if (buf[nw] != 0) {
-			sprintf(ptr, "%x\n", buf[nw]);
-			ptr += strlen(ptr);
-		} else {
-			*ptr++ = '\n';
-			*ptr = '\0';
+	try {
+	    while(nw < (unsigned)len) {
+		// Wait for the window to drain by at least half before
+		// sending anything more
+		if (nw - m_nacks > (unsigned)m_wrwindow/2) {
+			waitacks(nw - m_wrwindow/2);
+			continue;
+		}
+
+		while((nw < (unsigned)len)&&(nw - m_nacks < (unsigned)m_wrwindow)) {
+			// Each write command is ended by the start of the
+			// next one, so no newline is needed between them.
+			// A zero value needs no hex digits at all.
+			*ptr++ = 'W';
+			if (buf[nw] != 0) {
+				sprintf(ptr, "%x", buf[nw]);
+				ptr += strlen(ptr);
+			}
+			DBGPRINTF("WRITEV-SUB(%08x%s,&buf[%d] = 0x%08x,ACKS=%d)\n", a+((p)?(nw<<2):0), (p)?"++":"", nw, buf[nw], m_nacks);
+			nw ++;
 		}
 
-		DBGPRINTF("WRITEV-SUB(%08x%s,&buf[%d] = 0x%08x,ACKS=%d)\n", a+(nw<<2), (p)?"++":"", nw, buf[nw], m_nacks);
+		// End the final write of this batch, so it will be issued
+		*ptr++ = '\n';
+		*ptr = '\0';
+
 		m_dev->write(m_buf, ptr-m_buf);
 		DBGPRINTF(">> %s", m_buf);
+		ptr = m_buf;
 
-		while(m_nacks < (unsigned)nw)
-			readidle();
+		// Reconcile any acknowledgements that have already come back,
+		// without waiting on any others
+		readidle();
+	    }
 
-		nw ++;
-		ptr = m_buf;
+	    DBGPRINTF("Missing %d acks still\n", (unsigned)len-m_nacks);
+	    waitacks(len);
+	} catch(BUSERR b) {
+		BUSW	erraddr = a + ((p)?(m_nacks<<2):0);
+
+		DBGPRINTF("WRITEV::BUSERR writing %08x\n", erraddr);
+
+		// Writes following the one that failed are still in flight.
+		// Collect their responses, so they don't get confused with
+		// whatever we do next.
+		flushacks(nw - m_nacks - 1);
+		m_bus_err = true;
+		m_addr_set = false;
+		throw BUSERR(erraddr);
 	}
 
-	DBGPRINTF("Missing %d acks still\n", (unsigned)len-m_nacks);
-	while(m_nacks < (unsigned)len)
+	m_lastaddr = a + ((p)?(len<<2):0);
+	DBGPRINTF("WR: LAST ADDRESS LEFT AT %08x\n", m_lastaddr);
+}
+
+/*
+ * waitacks
+ *
+ * Block until at least nacks write acknowledgements have been received.
+ * Will throw a BUSERR if a bus error is received along the way.
+ */
+void	HEXBUS::waitacks(unsigned nacks) {
+	while(m_nacks < nacks) {
+		m_dev->poll(HEXB_ACKTIMEOUT);
 		readidle();
+	}
+}
 
-	if (p)
-		m_lastaddr += (len<<2);
-	DBGPRINTF("WR: LAST ADDRESS LEFT AT %08x\n", m_lastaddr);
+/*
+ * flushacks
+ *
+ * Following a bus error in the middle of a windowed write, read and discard
+ * the responses to any writes that were still outstanding.  As with
+ * flushreads(), any further bus errors are ignored.  We give up if the
+ * interface stops responding.
+ */
+void	HEXBUS::flushacks(int count) {
+	unsigned	target = m_nacks + 1 + count;	// +1 for the error
+
+	DBGPRINTF("FLUSH-ACKS(%d)\n", count);
+	while(m_nacks + 1 < target) {
+		if (!m_dev->poll(HEXB_ACKTIMEOUT))
+			break;
+		try {
+			readidle();
+		} catch(BUSERR b) {
+			// Count the error as a response, then keep going
+			target--;
+		}
+	}
 }
 
 /*
@@ -285,21 +355,51 @@ HEXBUS::BUSW	HEXBUS::readio(const HEXBUS::BUSW a) {
 	return v;
 }
 
+/*
+ * hexaddr
+ *
+ * Writes the shortest string of hex digits that the hexbus will sign extend
+ * back into the (32-bit) value v, returning the number of digits written.
+ * Since only the first digit of an address is sign extended, a positive
+ * value whose first digit is 8-f needs a leading zero, and a negative value
+ * can drop any leading f's so long as the digit following remains 8-f.
+ */
+static	int	hexaddr(char *str, const unsigned v) {
+	char	*ptr;
+
+	sprintf(str, "%x", v);
+	if (strlen(str) >= 8) {
+		ptr = str;
+		while((ptr[0] == 'f')&&(ptr[1] >= '8'))
+			ptr++;
+		if (ptr != str)
+			memmove(str, ptr, strlen(ptr)+1);
+	} else if (str[0] >= '8') {
+		memmove(&str[1], str, strlen(str)+1);
+		str[0] = '0';
+	}
+
+	return strlen(str);
+}
+
 /*
  * encode_address
  *
- * Creates a message to be sent across the bus with a new address value
- * in it.  If the low order bit of the address is set, then the address
+ * Places a message to be sent across the bus with a new address value in it
+ * into the buffer at ptr, returning a pointer to the character following.
+ * If the low order bit of the address is set, then the address
  * will not increment as operations are applied.
  *
- * For the hexbus interface, this is just about as simple as a sprintf(),
- * although other interfaces are more complicated.
+ * The hexbus will accept either an absolute address or, if bit[1] is set,
+ * a difference to be added to the current address.  Both are sign extended
+ * from their first digit.  Here, we pick whichever of the two takes the
+ * fewest characters to send.
  */
-char	*HEXBUS::encode_address(const HEXBUS::BUSW a) {
-	char	*ptr = m_buf;
+char	*HEXBUS::encode_address(char *ptr, const HEXBUS::BUSW a) {
+	char	diff[12];
 
 
-	if ((m_addr_set)&&(a == m_lastaddr)&&(m_inc == ((a&1)^1))) {
+	if ((m_addr_set)&&((a&-4) == m_lastaddr)&&(m_inc == ((a&1)^1))) {
 		DBGPRINTF("Address is already set to %08x\n", a);
 		return ptr;
 	}
@@ -308,22 +408,17 @@ char	*HEXBUS::encode_address(const HEXBUS::BUSW a) {
 	*ptr++ = HEXB_ADDR;
 
 	// Followed by the address in lower-case hex
-	// While I hate providing *ALL EIGHT* hex digits to this function,
-	// failing to do so causes overflows within the hexbus right now.
-	sprintf(ptr, "%08x", a);
+	hexaddr(ptr, a);
 
-/*
-	// If we can use an address difference, will it be valuable to do so?
-	// Not quite yet in our current design.
+	// If we know where the bus address is at now, will it be cheaper to
+	// send the difference instead?
 	if (m_addr_set) {
-		char	diff[9];
-
-		sprintf(diff, "%x", a-m_lastaddr);
+		hexaddr(diff, ((a&-4)-m_lastaddr)|2|(a&1));
 
 		if (strlen(diff) < strlen(ptr))
 			strcpy(ptr, diff);
 	}
-*/
+
 	ptr += strlen(ptr);
 	*ptr = '\0';
 
@@ -340,6 +435,13 @@ char	*HEXBUS::encode_address(const HEXBUS::BUSW a) {
  * end up here.  readv() reads a buffer of data from the given address, and
  * optionally increments (or not) the address after every read.
  *
+ * Rather than waiting on each word before requesting the next, up to
+ * m_rdwindow read requests are kept in flight at any given time.  Requests
+ * are sent in batches, with a new batch being sent any time half the window
+ * has been returned.  Since the hexbus returns its responses in order, the
+ * number of words received so far still tells us the address of any bus
+ * error.
+ *
  * Parameters:
  *	a	The address to start reading from
  *	inc	'1' if we want to increment the address following each read,
@@ -349,36 +451,56 @@ char	*HEXBUS::encode_address(const HEXBUS::BUSW a) {
  * 
  */
 void	HEXBUS::readv(const HEXBUS::BUSW a, const int inc, const int len, HEXBUS::BUSW *buf) {
-	int	nread = 0;
+	int	nread = 0, nsent = 0;
 	char	*ptr = m_buf;
 
 	if (len <= 0)
 		return;
 	DBGPRINTF("READV(%08x,%d,#%4d)\n", a, inc, len);
 
-	ptr = encode_address(a | ((inc)?0:1));
+	bufalloc(m_rdwindow + 16);
+	ptr = encode_address(m_buf, a | ((inc)?0:1));
 	m_lastaddr = a; m_addr_set = true; m_inc = inc;
 	try {
 	    while(nread < len) {
-		*ptr++ = HEXB_READ; // This will be a read request
+		// Top off the window of outstanding requests, but only once
+		// it has drained by at least half.  This keeps the number of
+		// writes we make small, while still keeping the link busy.
+		if ((nsent < len)&&((nsent - nread <= m_rdwindow/2)
+					||(nsent == nread))) {
+			while((nsent < len)&&(nsent - nread < m_rdwindow)) {
+				// Each request is a single 'R'.  The next
+				// command character ends the one before it.
+				*ptr++ = HEXB_READ;
+				nsent++;
+			}
 
-		// No other characters needed.  However, without a FIFO
-		// we'll need to terminate this command and wait for a
-		// response.
-		*ptr++ = '\n';
-		*ptr = '\0';
+			// Terminate the last request, so that it will be
+			// issued without waiting on another
+			*ptr++ = '\n';
+			*ptr = '\0';
+
+			m_dev->write(m_buf, (ptr-m_buf));
+			DBGPRINTF("READV: %d requests outstanding\n",
+				nsent - nread);
 
-		m_dev->write(m_buf, (ptr-m_buf));
+			// Clear the command buffer so we can start over
+			ptr = m_buf;
+		}
 
 		// Read the result from the bus
 		buf[nread++] = readword();
 		DBGPRINTF("READV [%08x/%08x] = %08x\n", nread-1, len, buf[nread-1]);
-
-		// Clear the command buffer so we can start over
-		ptr = m_buf;
 	    }
 	} catch(BUSERR b) {
 		DBGPRINTF("READV::BUSERR trying to read %08x\n", a+((inc)?(nread<<2):0));
+		// We can no longer be certain where the bus address was left,
+		// so make sure the next address is sent in full
+		m_addr_set = false;
+		// Any requests following the failed one are still in flight.
+		// Read (and ignore) their responses, so they don't get
+		// confused with the responses to whatever we do next.
+		flushreads(nsent - nread - 1);
 		throw BUSERR(a+((inc)?(nread<<2):0));
 	} catch(...) {
 		DBGPRINTF("Some other error caught\n");
@@ -402,6 +524,25 @@ void	HEXBUS::readv(const HEXBUS::BUSW a, const int inc, const int len, HEXBUS::B
 		(len>1)?", ...":"");
 }
 
+/*
+ * flushreads
+ *
+ * Following a bus error in the middle of a pipelined read, read and discard
+ * the responses to any requests that were still outstanding.  Further bus
+ * errors are ignored--we are already reporting the first one.
+ */
+void	HEXBUS::flushreads(int count) {
+	DBGPRINTF("FLUSH-READS(%d)\n", count);
+	while(count-- > 0) {
+		try {
+			readword();
+		} catch(BUSERR b) {
+			if (b.addr == 0)	// Interface went idle, abort
+				break;
+		}
+	}
+}
+
 /*
  * readi
  *
@@ -427,15 +568,165 @@ void	HEXBUS::readz(const HEXBUS::BUSW a, const int len, HEXBUS::BUSW *buf) {
 	readv(a, 0, len, buf);
 }
 
+/*
+ * runv
+ *
+ * Runs a list of transactions, keeping as many of their reads and writes in
+ * flight at once as our windows allow.  Commands for later transactions are
+ * sent while we are still waiting on the responses to earlier ones, so a
+ * list of small, scattered transactions costs little more than a single
+ * round trip.
+ *
+ * Reads and writes share the command FIFO within the RTL, so we keep the
+ * sum of the fractions of each window in use at or below one.  Every
+ * transaction starts with its own (absolute) address, and that address
+ * holds a place in the FIFO too, until the first response to its transaction
+ * tells us the bus executive has taken it.  We never send more commands than
+ * the FIFO can hold, addresses included.  Since the hexbus
+ * returns exactly one response for every read or write, whether it succeeds
+ * or fails, any bus error can be tied to the transaction that caused it and
+ * the rest carry on.
+ */
+void	HEXBUS::runv(const int n, BUSTRANS *t) {
+	int	ti = 0, wi = 0;	// The transaction and word to issue next
+	int	tc = 0, wc = 0;	// The transaction and word to collect next
+	int	nrd = 0, nwr = 0;	// The reads and writes outstanding
+	int	nad = 0;		// Addresses that may still be in the FIFO
+	const int	full = m_rdwindow * m_wrwindow;
+	unsigned	nacks = 0;
+	char	*ptr;
+
+	DBGPRINTF("RUNV(#%d)\n", n);
+	for(int k=0; k<n; k++)
+		t[k].m_err = false;
+
+	// An address takes at most ten characters, a write nine, a read one
+	bufalloc(19*(m_rdwindow + m_wrwindow) + 16);
+	m_nacks = 0;
+	while(tc < n) {
+		if ((ti < n)&&((nrd+nwr == 0)
+			||(2*(nrd*m_wrwindow + nwr*m_rdwindow) <= full))) {
+			ptr = m_buf;
+			while(ti < n) {
+				BUSTRANS	*p = &t[ti];
+				int	room, slots, nw = p->m_len - wi;
+
+				if (p->m_len <= 0) {
+					ti++;
+					continue;
+				}
+
+				room = full - nrd*m_wrwindow - nwr*m_rdwindow;
+				room /= (p->m_write) ? m_rdwindow : m_wrwindow;
+				// Nor may we overflow the command FIFO, counting
+				// the address a new transaction starts with
+				slots = HEXB_FIFOLN - nrd - nwr - nad
+					- ((wi == 0) ? 1 : 0);
+				if (room > slots)
+					room = slots;
+				if (nw > room)
+					nw = room;
+				if (nw <= 0)
+					break;
+
+				if (wi == 0) {
+					nad++;
+					m_addr_set = false;
+					ptr = encode_address(ptr,
+						p->m_addr|((p->m_inc)?0:1));
+				}
+
+				for(int k=0; k<nw; k++) {
+					if (p->m_write) {
+						*ptr++ = 'W';
+						if (p->m_buf[wi+k] != 0) {
+							sprintf(ptr, "%x", p->m_buf[wi+k]);
+							ptr += strlen(ptr);
+						}
+					} else
+						*ptr++ = HEXB_READ;
+				}
+
+				if (p->m_write)
+					nwr += nw;
+				else
+					nrd += nw;
+				wi += nw;
+				if (wi >= p->m_len) {
+					ti++;
+					wi = 0;
+				}
+			}
+
+			*ptr++ = '\n';
+			*ptr = '\0';
+			m_dev->write(m_buf, ptr-m_buf);
+			DBGPRINTF("RUNV: %d reads, %d writes outstanding\n",
+				nrd, nwr);
+		}
+
+		// Collect the response to the next word outstanding
+		BUSTRANS	*p = &t[tc];
+		if (wc >= p->m_len) {
+			tc++;
+			wc = 0;
+			continue;
+		}
+
+		try {
+			if (p->m_write) {
+				// Don't use waitacks() here, lest it swallow
+				// the read data that follows
+				while(m_nacks < nacks+1)
+					readword(true);
+				nacks++;
+			} else
+				p->m_buf[wc] = readword();
+		} catch(BUSERR b) {
+			BUSW	erraddr = p->m_addr + ((p->m_inc)?(wc<<2):0);
+
+			DBGPRINTF("RUNV::BUSERR at %08x\n", erraddr);
+			if (!p->m_err) {
+				p->m_err = true;
+				p->m_erraddr = erraddr;
+			}
+
+			if (b.addr == 0) {
+				// The interface has gone idle.  Nothing more
+				// is coming.
+				for(int k=tc+1; k<n; k++) {
+					t[k].m_err = true;
+					t[k].m_erraddr = t[k].m_addr;
+				} break;
+			}
+		}
+
+		if (p->m_write)
+			nwr--;
+		else
+			nrd--;
+		if (wc == 0)
+			// This transaction's address has now left the FIFO
+			nad--;
+		wc++;
+	}
+
+	// The bus address is wherever the last transaction left it, but it
+	// costs little to make certain of that by sending it again
+	m_addr_set = false;
+}
+
 /*
  * readword()
  *
  * Once the read command has been issued, readword() is called to read each
  * word's response from the bus.  This also processes any out of bounds
  * characters, such as interrupt notifications or bus error condition
- * notifications.
+ * notifications.  If ack is set, a write acknowledgement also ends the call,
+ * so that runv() can step through a mix of reads and writes one response at
+ * a time.
  */
-HEXBUS::BUSW	HEXBUS::readword(void) {
+HEXBUS::BUSW	HEXBUS::readword(const bool ack) {
 	int		nr;
 	unsigned	word, result, abort_countdown;
 	bool		done = false;
@@ -480,6 +771,10 @@ HEXBUS::BUSW	HEXBUS::readword(void) {
 				if (m_inc)
 					m_lastaddr += 4;
 				m_nacks++;
+				if (ack) {
+					result = 0;
+					done = true;
+				}
 			} else if (m_cmd == HEXB_INT) {
 				m_interrupt_flag = true;
 			} else if (m_cmd == HEXB_ERR) {
@@ -545,8 +840,9 @@ void	HEXBUS::readidle(void) {
 
 	// Repeat as long as there are values to be read
 	while(m_dev->available()) {
-		// Read one character from the interface
-		lclreadcode(&m_buf[0], 1);	// Number read must be one
+		// Read one character from the interface, skipping any idles
+		if (lclreadcode(&m_buf[0], 1) < 1)
+			continue;
 
 		// If it's a hexadecimal digit, adjust our word register
 		if (isdigit(m_buf[0]))
@@ -587,9 +883,14 @@ void	HEXBUS::readidle(void) {
 					m_lastaddr += 4;
 				m_nacks++;
 			} else if (m_cmd == HEXB_ERR) {
-				// On an err, throw a BUSERR exception
+				// On an err, throw a BUSERR exception.  Note
+				// the character ending the error first, so
+				// we don't report this same error twice.
 				DBGPRINTF("Bus error(%08x)-readidle\n", m_lastaddr);
 				m_bus_err = true;
+				m_isspace = (isspace(m_buf[0]))?true:false;
+				if (!m_isspace)
+					m_cmd = m_buf[0];
 				throw BUSERR(m_lastaddr);
 			} else if (m_cmd == HEXB_RESET) {
 				DBGPRINTF("BUS RESET\n");
@@ -51,6 +51,26 @@
 
 extern	bool	gbl_last_readidle;
 
+// The depth of the command FIFO (hbfifo) within the hexbus RTL.  Every read,
+// write, and address command we send takes a place within it until the bus
+// executive gets to it, and any more than this are dropped.
+#define	HEXB_FIFOLN	16
+
+// The number of read requests we'll keep in flight at once.  This needs to
+// be less than the depth of the command FIFO, leaving room for an address,
+// lest requests be dropped.
+#ifndef	HEXB_RDWINDOW
+#define	HEXB_RDWINDOW	8
+#endif
+
+// Likewise, the number of writes we'll allow to be unacknowledged at once
+#ifndef	HEXB_WRWINDOW
+#define	HEXB_WRWINDOW	8
+#endif
+
+// How long (in ms) to wait on the device for any write acknowledgements
+#define	HEXB_ACKTIMEOUT	20
+
 class	HEXBUS : public DEVBUS {
 public:
 	unsigned long	m_total_nread;
@@ -61,7 +81,7 @@ private:
 	unsigned int	m_lastaddr, m_nacks;
 	bool		m_inc, m_isspace;
 
-	int	m_buflen;
+	int	m_buflen, m_rdwindow, m_wrwindow;
 	char	*m_buf, m_cmd;
 
 	void	init(void) {
@@ -73,17 +93,22 @@ private:
 		m_bus_err    = false;
 		m_cmd = 0;
 		m_nacks = 0;
+		m_rdwindow = HEXB_RDWINDOW;
+		m_wrwindow = HEXB_WRWINDOW;
 		gbl_last_readidle = true;
 	}
 
 	void	bufalloc(int len);
-	BUSW	readword(void); // Reads a word value from the bus
+	BUSW	readword(const bool ack = false); // Reads a word value from the bus
 	void	readv(const BUSW a, const int inc, const int len, BUSW *buf);
 	void	writev(const BUSW a, const int p, const int len, const BUSW *buf);
 	void	readidle(void);
+	void	flushreads(int count);
+	void	waitacks(unsigned nacks);
+	void	flushacks(int count);
 
 	int	lclreadcode(char *buf, int len);
-	char	*encode_address(const BUSW a);
+	char	*encode_address(char *ptr, const BUSW a);
 public:
 	HEXBUS(LLCOMMSI *comms) : m_dev(comms) { init(); }
 	virtual	~HEXBUS(void) {
@@ -108,8 +133,37 @@ public:
 	bool	bus_err(void) const { return m_bus_err; };
 	void	reset_err(void) { m_bus_err = false; }
 	void	clear(void) { m_interrupt_flag = false; }
+
+	// Run a list of transactions, several at a time
+	void	runv(const int n, BUSTRANS *t);
+
+	// Set the maximum number of read requests that may be outstanding
+	// at any one time.  A window of one returns us to the original
+	// behavior of waiting on each word before requesting the next.  No
+	// window may be larger than the command FIFO, less one for the address.
+	void	readwindow(int w) { m_rdwindow = (w < 1) ? 1
+			: (w >= HEXB_FIFOLN) ? HEXB_FIFOLN-1 : w; }
+	int	readwindow(void) const { return m_rdwindow; }
+
+	// Set the maximum number of writes that may be unacknowledged at any
+	// one time.  As with the read window, this is bounded by the depth
+	// of the command FIFO within the RTL.
+	void	writewindow(int w) { m_wrwindow = (w < 1) ? 1
+			: (w >= HEXB_FIFOLN) ? HEXB_FIFOLN-1 : w; }
+	int	writewindow(void) const { return m_wrwindow; }
 };
 
+// Define BINBUS_MASTER to use the binary framed debugging bus, or WBU_MASTER
+// to use the compressing wbubus, in place of the hexbus.  The FPGA design must
+// be built to match.
+#ifdef	BINBUS_MASTER
+#include "binbus.h"
+typedef	BINBUS	FPGA;
+#elif	defined(WBU_MASTER)
+#include "wbubus.h"
+typedef	WBUBUS	FPGA;
+#else
 typedef	HEXBUS	FPGA;
+#endif
 
 #endif
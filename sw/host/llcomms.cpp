@@ -44,6 +44,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <stdio.h>
@@ -64,6 +65,7 @@ LLCOMMSI::LLCOMMSI(void) {
 	m_fdr = -1;
 	m_total_nread = 0l;
 	m_total_nwrit = 0l;
+	m_rxpos = m_rxlen = 0;
 }
 
 void	LLCOMMSI::write(char *buf, int len) {
@@ -76,13 +78,33 @@ void	LLCOMMSI::write(char *buf, int len) {
 	assert(nw == len);
 }
 
+/*
+ * read
+ *
+ * Return up to len bytes from our receive buffer.  Only once that buffer is
+ * empty do we go back to the device, and then we take everything it has
+ * (up to LLCOMMS_RXBUFSZ bytes) in a single read.  The bus drivers read
+ * their responses one byte at a time, so this keeps them from making a
+ * system call for every byte.
+ */
 int	LLCOMMSI::read(char *buf, int len) {
 	int	nr;
-	nr = ::read(m_fdr, buf, len);
-	if (nr <= 0) {
-		throw "Read-Failure";
+
+	if (m_rxpos >= m_rxlen) {
+		nr = ::read(m_fdr, m_rxbuf, LLCOMMS_RXBUFSZ);
+		if (nr <= 0) {
+			throw "Read-Failure";
+		}
+		m_total_nread += nr;
+		m_rxpos = 0;
+		m_rxlen = nr;
 	}
-	m_total_nread += nr;
+
+	nr = m_rxlen - m_rxpos;
+	if (nr > len)
+		nr = len;
+	memcpy(buf, &m_rxbuf[m_rxpos], nr);
+	m_rxpos += nr;
 	return nr;
 }
 
@@ -92,11 +114,16 @@ void	LLCOMMSI::close(void) {
 	if((m_fdr>=0)&&(m_fdr != m_fdw))
 		::close(m_fdr);
 	m_fdw = m_fdr = -1;
+	m_rxpos = m_rxlen = 0;
 }
 
 bool	LLCOMMSI::poll(unsigned ms) {
 	struct	pollfd	fds;
 
+	// Anything already in our buffer is ready to be read now
+	if (m_rxpos < m_rxlen)
+		return true;
+
 	fds.fd = m_fdr;
 	fds.events = POLLIN;
 	::poll(&fds, 1, ms);
@@ -107,6 +134,8 @@ bool	LLCOMMSI::poll(unsigned ms) {
 }
 
 int	LLCOMMSI::available(void) {
+	if (m_rxpos < m_rxlen)
+		return m_rxlen - m_rxpos;
 	return poll(0)?1:0;
 }
 
@@ -135,6 +164,35 @@ NETCOMMS::NETCOMMS(const char *host, const int port) {
 	struct sockaddr_in serv_addr; 
 	struct	hostent	*hp;
 
+	if (host[0] == '/') {
+		// A bus broker, on a UNIX-domain socket
+		struct	sockaddr_un	un_addr;
+
+#if	defined(BINBUS_MASTER) || defined(WBU_MASTER)
+		fprintf(stderr, "ERR: %s: the bus broker only speaks hexbus,\n"
+			"\tand this program was built for another bus\n", host);
+		exit(EXIT_FAILURE);
+#endif
+
+		if ((m_fdr = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+			printf("\n Error : Could not create socket \n");
+			exit(-1);
+		}
+
+		memset(&un_addr, 0, sizeof(un_addr));
+		un_addr.sun_family = AF_UNIX;
+		strncpy(un_addr.sun_path, host, sizeof(un_addr.sun_path)-1);
+		if (connect(m_fdr, (struct sockaddr *)&un_addr,
+				sizeof(un_addr)) < 0) {
+			fprintf(stderr, "Could not connect to %s\n", host);
+			perror("Connect Failed Err");
+			exit(-1);
+		}
+
+		m_fdw = m_fdr;
+		return;
+	}
+
 	if ((m_fdr = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
 		printf("\n Error : Could not create socket \n");
 		exit(-1);
@@ -41,9 +41,19 @@
 #ifndef	LLCOMMS_H
 #define	LLCOMMS_H
 
+// The size of our receive buffer.  Rather than issuing one read() per byte,
+// we read whatever is available, up to this many bytes, at once.
+#define	LLCOMMS_RXBUFSZ	4096
+
 class	LLCOMMSI {
 protected:
 	int	m_fdw, m_fdr;
+
+	// Bytes received but not yet returned by read(), from m_rxbuf[m_rxpos]
+	// up to (but not including) m_rxbuf[m_rxlen]
+	char	m_rxbuf[LLCOMMS_RXBUFSZ];
+	int	m_rxpos, m_rxlen;
+
 	LLCOMMSI(void);
 public:
 	unsigned long	m_total_nread, m_total_nwrit;
@@ -58,6 +68,9 @@ public:
 	// Tests whether or not bytes are available to be read, returns a 
 	// count of the bytes that may be immediately read
 	virtual	int	available(void); // { return 0; };
+
+	// The number of bytes already received and waiting in our buffer
+	int	buffered(void) const { return m_rxlen - m_rxpos; }
 };
 
 class	TTYCOMMS : public LLCOMMSI {
@@ -65,10 +78,23 @@ public:
 	TTYCOMMS(const char *dev);
 };
 
+// Any host name starting with a '/' is taken to be the path to a bus broker's
+// UNIX-domain socket, rather than the name of a network host.  Since the
+// broker only speaks hexbus, this is an error when built for any other bus.
 class	NETCOMMS : public LLCOMMSI {
 public:
 	NETCOMMS(const char *dev, const int port);
 	virtual	void	close(void);
 };
 
+// A connection to a bus broker (busbroker), sharing its one connection to
+// the FPGA with any other programs connected to the same broker.  The broker
+// speaks the hexbus protocol to its clients.
+#if	!defined(BINBUS_MASTER) && !defined(WBU_MASTER)
+class	BROKERCOMMS : public NETCOMMS {
+public:
+	BROKERCOMMS(const char *path) : NETCOMMS(path, 0) {}
+};
+#endif
+
 #endif
@@ -43,6 +43,7 @@
 #include <termios.h>
 #include <assert.h>
 #include <vector>
+#include <deque>
 #include <string.h>
 #include <ctype.h>
 #include <errno.h>
@@ -54,25 +55,25 @@
 #include <arpa/inet.h>
 #include <poll.h>
 #include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
 
 #include <sched.h>
 
 
-bool verbose = false;
-
-#  include <wiringPi.h>
+#include "ppgpio.h"
+#include "ringbuf.h"
+#include "asynclog.h"
 
-//
-// For reference, here are four valuable definitions found within wiringPi.h
-//
-// #define	LOW	0
-// #define	HIGH	1
-// #define	INPUT	0
-// #define	OUTPUT	1
+bool verbose = false;
 
 //
 // RPi GPIO #, connector pin #, schematic name, fpga pin #
 //
+// These are wiringPi GPIO numbers.  ppgpio.cpp uses the BCM numbers given
+// alongside.
+//
  
 
 #  define RASPI_DIR 28 //BCM20 	PIN 38, GPIO.28 IOB_59  R3
@@ -92,15 +93,26 @@ bool verbose = false;
 #  define RASPI_D8 11 //BCM7 	PIN 26, GPIO.11, IOB_75	T7
 #  define RASPI_CLKFB RASPI_D8
 
-#define	READ_FROM_ICO	0
-#define	WRITE_TO_ICO	1
-
 class	MUXDCOMMS {
 private:
-	char		*m_rd_buf;
-	unsigned	m_rd_pos;
-	unsigned	m_rd_fill;
-	unsigned	m_rd_size;
+	// Bytes read back from the FPGA while writing to it, but not yet
+	// returned by read()
+	RINGBUF		m_rd;
+	PPGPIO		*m_gpio;
+	// True if we may send bursts of bytes, false if the FPGA needs us to
+	// read a byte back for every byte we send
+	bool		m_burst;
+
+// The most bytes we'll send in one burst, and the most we'll then read back
+// before sending another.  Each byte of a burst can create several bytes
+// of response, so the FPGA's transmit FIFO (512 bytes, LGTXFIFO=9, set in the
+// @MAIN.INSERT of auto-data/hbconsole.txt and auto-data/wbuconsole.txt) needs
+// to be able to hold the responses to at least a couple of bursts.
+#define	PP_BURSTLN	32
+#define	PP_DRAINLN	512
+// The size of m_rd.  We won't write to the FPGA unless this has room for
+// another PP_DRAINLN bytes of its responses.
+#define	PP_RDBUFSZ	8192
 
 // #define	PAUSE	sched_yield()
 #define	PAUSE
@@ -111,113 +123,87 @@ private:
 		for(unsigned i=0; i<nbytes; i++) {
 			char	datab = data[i];
 
-			digitalWrite(RASPI_DIR, OUTPUT);
-			digitalWrite(RASPI_CLK, 0);
+			m_gpio->ctrl(WRITE_TO_ICO, 0);
 			//
-			while(digitalRead(RASPI_CLKFB) != 0)
-				PAUSE;
-			pinMode(RASPI_D7, OUTPUT);
-			pinMode(RASPI_D6, OUTPUT);
-			pinMode(RASPI_D5, OUTPUT);
-			pinMode(RASPI_D4, OUTPUT);
-			pinMode(RASPI_D3, OUTPUT);
-			pinMode(RASPI_D2, OUTPUT);
-			pinMode(RASPI_D1, OUTPUT);
-			pinMode(RASPI_D0, OUTPUT);
-
-			digitalWrite(RASPI_D7, (datab & 0x80) ? 1:0);
-			digitalWrite(RASPI_D6, (datab & 0x40) ? 1:0);
-			digitalWrite(RASPI_D5, (datab & 0x20) ? 1:0);
-			digitalWrite(RASPI_D4, (datab & 0x10) ? 1:0);
-			digitalWrite(RASPI_D3, (datab & 0x08) ? 1:0);
-			digitalWrite(RASPI_D2, (datab & 0x04) ? 1:0);
-			digitalWrite(RASPI_D1, (datab & 0x02) ? 1:0);
-			digitalWrite(RASPI_D0, (datab & 0x01) ? 1:0);
-
-			digitalWrite(RASPI_CLK, 1);
-			while(digitalRead(RASPI_CLK) != 1)
+			while(m_gpio->pins() & PP_CLKFB)
 				PAUSE;
-			while(digitalRead(RASPI_CLKFB) == 0)
+			m_gpio->drive(true);
+
+			// Set the data and raise the clock, all at once
+			m_gpio->wrdata(datab, 1);
+			while((m_gpio->pins() & (PP_CLK|PP_CLKFB))
+					!= (PP_CLK|PP_CLKFB))
 				PAUSE;
 
-			pinMode(RASPI_D7, INPUT);
-			pinMode(RASPI_D6, INPUT);
-			pinMode(RASPI_D5, INPUT);
-			pinMode(RASPI_D4, INPUT);
-			pinMode(RASPI_D3, INPUT);
-			pinMode(RASPI_D2, INPUT);
-			pinMode(RASPI_D1, INPUT);
-			pinMode(RASPI_D0, INPUT);
-
-			digitalWrite(RASPI_DIR, INPUT);
-			digitalWrite(RASPI_CLK, 0);
-			while(digitalRead(RASPI_CLKFB) != 0)
+			m_gpio->drive(false);
+
+			m_gpio->ctrl(READ_FROM_ICO, 0);
+			while(m_gpio->pins() & PP_CLKFB)
 				PAUSE;
-			digitalWrite(RASPI_CLK, 1);
-			while(digitalRead(RASPI_CLKFB) != 1)
+			m_gpio->clk(1);
+			while(0 == (m_gpio->pins() & PP_CLKFB))
 				PAUSE;
 
-			datab = 0;
-			if (digitalRead(RASPI_D7))	datab |= 0x80;
-			if (digitalRead(RASPI_D6))	datab |= 0x40;
-			if (digitalRead(RASPI_D5))	datab |= 0x20;
-			if (digitalRead(RASPI_D4))	datab |= 0x10;
-			if (digitalRead(RASPI_D3))	datab |= 0x08;
-			if (digitalRead(RASPI_D2))	datab |= 0x04;
-			if (digitalRead(RASPI_D1))	datab |= 0x02;
-			if (digitalRead(RASPI_D0))	datab |= 0x01;
-
-			if (datab != 0x0ff)
+			datab = m_gpio->pins() & PP_DATA;
+
+			if ((datab & 0x0ff) != 0x0ff)
 				rdbuf[nr++] = datab;
 		}
-		digitalWrite(RASPI_DIR, INPUT);
-		digitalWrite(RASPI_CLK, 0);
+		m_gpio->ctrl(READ_FROM_ICO, 0);
 
 		return nr;
 	}
 
 
+	// Send a burst of bytes to the FPGA.  Unlike pp_xfer(), the data lines
+	// are turned around only once for the whole burst, and nothing is
+	// read back between bytes.  The FPGA holds onto any responses in its
+	// transmit FIFO until we come back for them.
+	void	pp_burst(unsigned nbytes, const char *data) {
+		m_gpio->ctrl(WRITE_TO_ICO, 0);
+		while(m_gpio->pins() & PP_CLKFB)
+			PAUSE;
+		m_gpio->drive(true);
+
+		for(unsigned i=0; i<nbytes; i++) {
+			m_gpio->wrdata(data[i], 1);
+			while(0 == (m_gpio->pins() & PP_CLKFB))
+				PAUSE;
+			m_gpio->clk(0);
+			while(m_gpio->pins() & PP_CLKFB)
+				PAUSE;
+		}
+
+		m_gpio->drive(false);
+		m_gpio->ctrl(READ_FROM_ICO, 0);
+	}
+
 	unsigned	pp_read(unsigned nbytes, char *data) {
 		unsigned	nr = 0;
 
-		digitalWrite(RASPI_CLK, 0);
-		pinMode(RASPI_D7, INPUT);
-		pinMode(RASPI_D6, INPUT);
-		pinMode(RASPI_D5, INPUT);
-		pinMode(RASPI_D4, INPUT);
-		pinMode(RASPI_D3, INPUT);
-		pinMode(RASPI_D2, INPUT);
-		pinMode(RASPI_D1, INPUT);
-		pinMode(RASPI_D0, INPUT);
-		digitalWrite(RASPI_DIR, INPUT);
-		while(digitalRead(RASPI_DIR) != INPUT)
+		m_gpio->clk(0);
+		m_gpio->drive(false);
+		m_gpio->ctrl(READ_FROM_ICO, 0);
+		while(m_gpio->pins() & PP_DIR)
 			PAUSE;
 
 		for(unsigned i=0; i<nbytes; i++) {
-			char	datab = 0;
+			char	datab;
 
-			while(digitalRead(RASPI_CLKFB) != 0)
+			while(m_gpio->pins() & PP_CLKFB)
 				PAUSE;
-			digitalWrite(RASPI_CLK, 1);
-			while(digitalRead(RASPI_CLK) == 0)
-				PAUSE;
-			while(digitalRead(RASPI_CLKFB) == 0)
+			m_gpio->clk(1);
+			while((m_gpio->pins() & (PP_CLK|PP_CLKFB))
+					!= (PP_CLK|PP_CLKFB))
 				PAUSE;
 
-			if (digitalRead(RASPI_D7))	datab |= 0x80;
-			if (digitalRead(RASPI_D6))	datab |= 0x40;
-			if (digitalRead(RASPI_D5))	datab |= 0x20;
-			if (digitalRead(RASPI_D4))	datab |= 0x10;
-			if (digitalRead(RASPI_D3))	datab |= 0x08;
-			if (digitalRead(RASPI_D2))	datab |= 0x04;
-			if (digitalRead(RASPI_D1))	datab |= 0x02;
-			if (digitalRead(RASPI_D0))	datab |= 0x01;
-
-			digitalWrite(RASPI_CLK, 0);
-			while(digitalRead(RASPI_CLK) != 0)
+			datab = m_gpio->pins() & PP_DATA;
+
+			m_gpio->clk(0);
+			while(m_gpio->pins() & PP_CLK)
 				PAUSE;
 
-			if (datab == 0x0ff)
+			if ((datab & 0x0ff) == 0x0ff)
 				break;
 			data[nr++] = datab;
 		}
@@ -226,122 +212,65 @@ private:
 	}
 
 	bool	pp_idle(void) {
-		if ( digitalRead(RASPI_CLK))	return false;
-		if ( digitalRead(RASPI_CLKFB))	return false;
-		if (!digitalRead(RASPI_D7))	return false;
-		if (!digitalRead(RASPI_D6))	return false;
-		if (!digitalRead(RASPI_D5))	return false;
-		if (!digitalRead(RASPI_D4))	return false;
-		if (!digitalRead(RASPI_D3))	return false;
-		if (!digitalRead(RASPI_D2))	return false;
-		if (!digitalRead(RASPI_D1))	return false;
-		if (!digitalRead(RASPI_D0))	return false;
-		return true;
+		// Idle when neither clock is high and the FPGA has nothing
+		// (all ones) on the data lines
+		return ((m_gpio->pins() & (PP_CLK|PP_CLKFB|PP_DATA))==PP_DATA);
 	}
 
 	void	pp_dump(void) {
-		unsigned	datab = 0; // , clk=0, clkfb=0, dir=0;
-
-		// dir   = digitalRead(RASPI_DIR);
-		// clk   = digitalRead(RASPI_CLK);
-		// clkfb = digitalRead(RASPI_CLKFB);
-
-		if (digitalRead(RASPI_D7))	datab |= 0x80;
-		if (digitalRead(RASPI_D6))	datab |= 0x40;
-		if (digitalRead(RASPI_D5))	datab |= 0x20;
-		if (digitalRead(RASPI_D4))	datab |= 0x10;
-		if (digitalRead(RASPI_D3))	datab |= 0x08;
-		if (digitalRead(RASPI_D2))	datab |= 0x04;
-		if (digitalRead(RASPI_D1))	datab |= 0x02;
-		if (digitalRead(RASPI_D0))	datab |= 0x01;
+		// unsigned	datab = m_gpio->pins();
 
 /*
 		printf("%s %s/%s %02x\n",
-			(dir)?"OUT":" IN",
-			(clk)?"CLK":" ( )",
-			(clkfb)?"FB":" ()",
+			(datab & PP_DIR)?"OUT":" IN",
+			(datab & PP_CLK)?"CLK":" ( )",
+			(datab & PP_CLKFB)?"FB":" ()",
 			datab & 0x0ff);
 */
 	}
 
-	void	pp_init(void) {
-		// Initialize the wiringPi library
-		wiringPiSetup();
-
-		// Comms take place over 8 bidirectional data bits, a clock,
-		// and a direction bit
-
-		pinMode(RASPI_DIR, OUTPUT);
-		digitalWrite(RASPI_DIR, OUTPUT);
-		pinMode(RASPI_CLK, OUTPUT);
-		digitalWrite(RASPI_CLK, 0);
-		pinMode(RASPI_CLKFB, INPUT);
-		pinMode(RASPI_D7,    INPUT);
-		pinMode(RASPI_D6,    INPUT);
-		pinMode(RASPI_D5,    INPUT);
-		pinMode(RASPI_D4,    INPUT);
-		pinMode(RASPI_D3,    INPUT);
-		pinMode(RASPI_D2,    INPUT);
-		pinMode(RASPI_D1,    INPUT);
-		pinMode(RASPI_D0,    INPUT);
-		digitalWrite(RASPI_DIR, INPUT);
-	}
-
 public:
-	MUXDCOMMS(void) {
-		m_rd_size = 8192;
-		m_rd_buf = new char[m_rd_size];
-		m_rd_fill = 0;
-		m_rd_pos  = 0;
-		pp_init();
-	}
+	MUXDCOMMS(PPGPIO *gpio, bool burst = true)
+			: m_rd(PP_RDBUFSZ), m_gpio(gpio), m_burst(burst) {}
 
 	unsigned	read(unsigned nreq, char *buf) {
-		unsigned	nr = 0;
-
-		if (m_rd_fill > 0) {
-			unsigned ln = nreq;
-			if (ln > m_rd_fill)
-				ln = m_rd_fill;
-			memcpy(&buf[nr], &m_rd_buf[m_rd_pos], ln);
-			m_rd_pos  += ln;
-			m_rd_fill -= ln;
-			if (m_rd_fill == 0)
-				m_rd_pos = 0;
-			nr += ln;
-		}
+		unsigned	nr;
 
+		nr = m_rd.read(buf, nreq);
 		if (nr < nreq)
 			nr += pp_read(nreq - nr, &buf[nr]);
 
 		return nr;
 	}
 
-	void	write(unsigned nreq, char *buf) {
-		unsigned	nr;
-
-		if (nreq > m_rd_size - m_rd_fill - m_rd_pos) {
-			if (m_rd_pos > 0) {
-				memmove(m_rd_buf, &m_rd_buf[m_rd_pos], m_rd_fill);
-				m_rd_pos = 0;
-			}
-			if (nreq > m_rd_size - m_rd_fill) {
-				unsigned	newsz;
-				char		*alt;
-
-				newsz = m_rd_size;
-				while(newsz < m_rd_fill + nreq)
-					newsz <<= 1;
-
-				alt = new char[newsz];
-				memcpy(alt, m_rd_buf, m_rd_fill);
-				delete m_rd_buf;
-				m_rd_buf = alt;
+	// Send up to nreq bytes, returning the number sent.  This stops short
+	// whenever m_rd gets too full to hold the responses to any more,
+	// leaving those responses with the FPGA until read() makes room.
+	unsigned	write(unsigned nreq, const char *buf) {
+		char		rdbuf[PP_DRAINLN];
+		unsigned	pos = 0, ln;
+
+		while((pos < nreq)&&(m_rd.room() >= PP_DRAINLN)) {
+			ln = nreq - pos;
+			if (m_burst) {
+				if (ln > PP_BURSTLN)
+					ln = PP_BURSTLN;
+				pp_burst(ln, &buf[pos]);
+
+				// Collect whatever responses are ready before
+				// the next burst, so they don't pile up in
+				// the FPGA
+				m_rd.write(rdbuf, pp_read(PP_DRAINLN, rdbuf));
+			} else {
+				// Every byte sent returns at most one byte
+				if (ln > PP_DRAINLN)
+					ln = PP_DRAINLN;
+				m_rd.write(rdbuf, pp_xfer(ln, &buf[pos],rdbuf));
 			}
+			pos += ln;
 		}
 
-		nr = pp_xfer(nreq, buf, &m_rd_buf[m_rd_pos]);
-		m_rd_fill += nr;
+		return pos;
 	}
 
 	bool	is_idle(void) { return pp_idle(); }
@@ -354,11 +283,15 @@ public:
 #define	SHORTWHILE	1
 #define	LONGWHILE	20
 
+// Everything we have to say about the traffic passing through us goes here,
+// to be written out by its own thread
+ASYNCLOG	*netlog;
+
 int	setup_listener(const int port) {
 	int	skt;
 	struct  sockaddr_in     my_addr;
 
-	printf("Listening on port %d\n", port);
+	netlog->printf(ALOG_INFO, "Listening on port %d", port);
 
 	skt = socket(AF_INET, SOCK_STREAM, 0);
 	if (skt < 0) {
@@ -394,21 +327,137 @@ int	setup_listener(const int port) {
 	return skt;
 }
 
-class	LINBUFS {
+// The size of each of the rings between the port and network threads, and the
+// most we'll move through any of them at once
+#define	NETPP_RINGSZ	65536
+#define	NETPP_CHUNK	256
+
+MUXDCOMMS	*pport;
+
+// Each thread waits on one of these when it has nothing to do, and the other
+// thread writes to it to wake it up
+int	port_event, net_event;
+
+void	notify(int fd) {
+	uint64_t	one = 1;
+
+	if (::write(fd, &one, sizeof(one)) < 0)
+		perror("Notify Err:");
+}
+
+void	clear_event(int fd) {
+	uint64_t	v;
+
+	if (::read(fd, &v, sizeof(v)) < 0 && errno != EAGAIN)
+		perror("Event Err:");
+}
+
+//
+// LINELOG
+//
+// Gathers the bytes passing one way through a channel into lines, and hands
+// them to the log.  The log only prints the prefix later, so it must be a
+// constant.
+//
+class	LINELOG {
+	int	m_chan, m_len;
+	char	m_line[512];
+public:
+	LINELOG(const char *name) : m_len(0) {
+		m_chan = netlog->channel(name);
+	}
+
+	void	add(const char *buf, int ln, const char *prefix = NULL) {
+		netlog->count(m_chan, ln);
+		for(int i=0; i<ln; i++) {
+			char	ch = buf[i] & 0x07f;
+
+			if ((ch == '\n')||(ch == '\r')) {
+				flush(prefix);
+				continue;
+			}
+
+			m_line[m_len++] = ch;
+			if ((unsigned)m_len >= sizeof(m_line))
+				flush(prefix);
+		}
+	}
+
+	void	flush(const char *prefix = NULL) {
+		if (m_len > 0)
+			netlog->line(m_chan, prefix, m_line, m_len);
+		m_len = 0;
+	}
+};
+
+//
+// NETWAITER
+//
+// Anything the network thread waits on.  Each is handed to epoll as the data
+// pointer of its file descriptors, and its event() method is then called with
+// whatever epoll reports for them.
+//
+class	NETWAITER {
+public:
+	virtual	~NETWAITER(void) {}
+	virtual	void	event(int ep, unsigned events) = 0;
+
+	void	watch(int ep, int fd, int op, unsigned events) {
+		struct	epoll_event	ev;
+
+		ev.events = events;
+		ev.data.ptr = this;
+		if (epoll_ctl(ep, op, fd, &ev) != 0) {
+			perror("EPOLL Err:");
+			exit(EXIT_FAILURE);
+		}
+	}
+};
+
+//
+// LINBUFS
+//
+// The console channel, together with the rings carrying its bytes to and from
+// the port thread.  Everything here but the rings belongs to the network
+// thread.
+//
+class	LINBUFS : public NETWAITER {
 public:
-	char	m_iline[512], m_oline[512];
-	char	m_buf[256];
-	int	m_ilen, m_olen;
-	int	m_fd;
+	const char	*m_name;
+	int	m_fd, m_skt;
 	bool	m_connected;
-	MUXDCOMMS	*m_pport;
+	// Bytes on their way to the port, and from the port
+	RINGBUF	m_topp, m_fromp;
+	// Bytes taken from m_fromp, but not yet written to the network
+	char	m_wbuf[NETPP_CHUNK];
+	int	m_wpos, m_wlen;
+	// The events we're currently waiting on for m_fd
+	unsigned	m_events;
+	// The lines coming in from the FPGA, and those going out to it
+	LINELOG	m_login, m_logout;
+
+	LINBUFS(const char *name, int skt)
+			: m_topp(NETPP_RINGSZ), m_fromp(NETPP_RINGSZ),
+			m_login("Con-in"), m_logout("Con-out") {
+		m_name = name; m_skt = skt;
+		m_connected = false; m_fd = -1;
+		m_wpos = m_wlen = 0;
+		m_events = 0;
+	}
 
-	LINBUFS(MUXDCOMMS *pport) {
-		m_ilen = 0; m_olen = 0; m_connected = false; m_fd = -1;
-		m_pport = pport;
+	virtual	void	event(int ep, unsigned events) {
+		if (!m_connected) {
+			accept(ep);
+			return;
+		}
+
+		if (events & (EPOLLIN|EPOLLRDHUP|EPOLLERR))
+			rx(ep);
+		if (events & (EPOLLHUP|EPOLLERR))
+			close(ep);
 	}
 
-	void	close(void) {
+	void	close(int ep) {
 		if (!m_connected) {
 			m_fd = -1;
 			return;
@@ -416,283 +465,828 @@ public:
 			m_connected = false;
 			return;
 		}
+		m_logout.flush("( ");
+		epoll_ctl(ep, EPOLL_CTL_DEL, m_fd, NULL);
 		::close(m_fd);
 		m_fd = -1;
 		m_connected = false;
-	}
+		netlog->printf(ALOG_INFO, "%s port closed", m_name);
 
-	int	read(void) {
-		if (!m_connected)
-			return 0;
-		else
-			return ::read(m_fd, m_buf, sizeof(m_buf));
+		// Listen for the next connection
+		watch(ep, m_skt, EPOLL_CTL_ADD, EPOLLIN);
 	}
 
-	void	accept(const int skt) {
-		m_fd = ::accept(skt, 0, 0);
+	void	accept(int ep) {
+		m_fd = ::accept(m_skt, 0, 0);
 		if (m_fd < 0) {
-			perror("CMD Accept failed!  O/S Err:");
+			perror("CON Accept failed!  O/S Err:");
 			exit(EXIT_FAILURE);
 		} m_connected = (m_fd >= 0);
+		fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK);
+		netlog->printf(ALOG_INFO, "%s port is now connected", m_name);
+
+		// Only one connection at a time
+		epoll_ctl(ep, EPOLL_CTL_DEL, m_skt, NULL);
+		m_events = EPOLLIN | EPOLLRDHUP;
+		watch(ep, m_fd, EPOLL_CTL_ADD, m_events);
 	}
 
-	void	pp_write(int ln, int mask = 0) {
-		if (mask) {
-			for(int i=0; i<ln; i++)
-				m_buf[i] |= mask;
+	// Read from the network into the ring to the port, but only as much as
+	// there's room for.  When the ring is full, we stop reading (see
+	// update()) until the port thread makes room.
+	void	rx(int ep) {
+		char	buf[NETPP_CHUNK];
+		int	nr;
+		unsigned	ln = m_topp.room();
+
+		if (!m_connected || ln == 0)
+			return;
+		if (ln > sizeof(buf))
+			ln = sizeof(buf);
+
+		nr = ::read(m_fd, buf, ln);
+		if (nr == 0 || (nr < 0 && errno != EAGAIN)) {
+			close(ep);
+		} else if (nr > 0) {
+			m_topp.write(buf, nr);
+			notify(port_event);
+			m_logout.add(buf, nr, "( ");
 		}
+	}
+
+	// Write whatever has come from the port out to the network, for as
+	// long as the network will take it.  Bytes that arrive with nobody
+	// connected are logged, and then dropped.
+	void	tx(int ep) {
+		while(1) {
+			if (m_wpos >= m_wlen) {
+				bool	stalled = m_fromp.room() < NETPP_CHUNK;
+
+				m_wpos = 0;
+				m_wlen = m_fromp.read(m_wbuf, sizeof(m_wbuf));
+				if (m_wlen == 0)
+					return;
+				if (stalled)
+					notify(port_event);
+
+				m_login.add(m_wbuf, m_wlen,
+					(m_connected) ? ") " : ". ");
+			}
+
+			if (!m_connected) {
+				m_wpos = m_wlen;
+				continue;
+			}
 
-		if (ln > 0)
-			m_pport->write((unsigned)ln, m_buf);
+			int nw = ::write(m_fd, &m_wbuf[m_wpos], m_wlen-m_wpos);
+			if (nw < 0 && errno == EAGAIN)
+				return;	// Wait for EPOLLOUT
+			else if (nw <= 0) {
+				// This fails when the other end resets the
+				// connection.  Thus, we'll just kindly close
+				// the connection.
+				m_wpos = m_wlen;
+				close(ep);
+			} else
+				m_wpos += nw;
+		}
 	}
 
-	int	write(int fd, int ln, int mask = 0) {
-		int	pos = 0, nw;
+	// Adjust what we wait on: input only if we have room to put it, output
+	// only if there's something we couldn't write
+	void	update(int ep) {
+		unsigned	events = 0;
 
-		if (mask) {
-			for(int i=0; i<ln; i++)
-				m_buf[i] |= mask;
+		if (!m_connected)
+			return;
+		if (m_topp.room() > 0)
+			events |= EPOLLIN | EPOLLRDHUP;
+		if (m_wpos < m_wlen)
+			events |= EPOLLOUT;
+		if (events != m_events) {
+			m_events = events;
+			watch(ep, m_fd, EPOLL_CTL_MOD, events);
 		}
+	}
+};
 
-		do {
-			nw = ::write(fd, &m_buf[pos], ln-pos);
+// The most command clients we'll serve at once
+#define	NETPP_MAXCLIENTS	8
+// Only hexbus requests can be decoded and interleaved between clients.  Any
+// other bus gets but one client, whose bytes are passed through untouched.
+#if	defined(BINBUS_MASTER) || defined(WBU_MASTER)
+#define	NETPP_DEFCLIENTS	1
+#else
+#define	NETPP_DEFCLIENTS	NETPP_MAXCLIENTS
+#endif
+// The longest request line we'll hold for any client.  Longer lines are split
+// between commands.
+#define	NETPP_REQLN		1024
+// The most hexbus requests we'll keep in flight at once, summed across all
+// clients, lest we overflow the hexbus command FIFO (16 words, see hbfifo).
+#define	NETPP_MAXINFLIGHT	14
+// Room for the address we might place ahead of a client's requests
+#define	NETPP_ADDRLN		12
+
+class	CMDMUX;
 
-			if ((nw < 0)&&(errno == EAGAIN)) {
-				nw = 0;
-				usleep(10);
-			} else if (nw < 0) {
-				fprintf(stderr, "ERR: %4d\n", errno);
-				perror("O/S Err: ");
-				exit(EXIT_FAILURE);
-				break;
-			} else if (nw == 0) {
-				// TTY(i.e. FPGA) dev has closed our connection
-				fprintf(stderr, "Device has closed\n");
-				exit(EXIT_SUCCESS);
-				break;
-			}
-			pos += nw;
-		} while(pos < ln);
+//
+// CMDCLIENT
+//
+// One connection to the command port.  Requests are held here until the
+// CMDMUX sends them on to the port, and responses are held until the client
+// takes them.  As this client's requests are sent, we follow where they leave
+// the bus address, so that it can be put back should another client move it.
+//
+class	CMDCLIENT : public NETWAITER {
+public:
+	CMDMUX	*m_mux;
+	int	m_fd, m_id;
+	bool	m_closed;
+	// Requests received, but not yet sent on to the port
+	char	m_req[NETPP_REQLN];
+	int	m_reqlen;
+	// Responses waiting on the client to take them
+	RINGBUF	m_rsp;
+	// The bus address, as this client's requests have left it, whether
+	// it increments, and whether we know it at all
+	unsigned	m_addr;
+	bool	m_inc, m_known;
+	// Where we are in decoding the requests sent so far.  m_cmd is the
+	// command whose payload is being received, m_word that payload.
+	int	m_cmd;
+	unsigned	m_word;
+	bool	m_first;
+	// The events we're currently waiting on for m_fd
+	unsigned	m_events;
+
+	CMDCLIENT(CMDMUX *mux, int fd, int id) : m_rsp(NETPP_RINGSZ) {
+		m_mux = mux; m_fd = fd; m_id = id;
+		m_closed = false;
+		m_reqlen = 0;
+		m_addr = 0; m_inc = true; m_known = false;
+		m_cmd = 0; m_word = 0; m_first = false;
+		m_events = 0;
+	}
 
-		return pos;
+	virtual	void	event(int ep, unsigned events);
+	void	rx(void);
+	void	tx(void);
+	void	update(int ep);
+	int	next(void);
+	int	track(const char *buf, int ln);
+};
+
+//
+// CMDMUX
+//
+// The command channel.  Any number of clients (up to NETPP_MAXCLIENTS) may be
+// connected to it at once, each speaking hexbus.  Their requests are sent to
+// the port a line at a time, taking turns, so that one client's requests are
+// only ever interleaved with another's at the end of a line.  Each request
+// we send is tagged, in order, with the client that sent it.  Since the FPGA
+// answers every request once, and in order, the tags then tell us where each
+// response needs to go.  Interrupts, idle and reset indications belong to
+// everyone.
+//
+// Should the bus support some other protocol, as the binbus or wbubus do, this
+// only works with a single client and no decoding, as when m_passthru is set.
+//
+class	CMDMUX : public NETWAITER {
+public:
+	int	m_skt, m_maxclients;
+	bool	m_passthru;
+	// Bytes on their way to the port, and from the port
+	RINGBUF	m_topp, m_fromp;
+	CMDCLIENT	*m_client[NETPP_MAXCLIENTS];
+	int	m_nclients, m_next, m_nextid;
+	// The client whose requests the bus address was last left at
+	CMDCLIENT	*m_owner;
+	// The client that sent each request in flight, in the order the
+	// FPGA will answer them.  Requests we've made ourselves belong to
+	// no one (NULL).
+	std::deque<CMDCLIENT *>	m_tags;
+	// Where the response currently being received is going: to m_dest,
+	// or to every client if m_bcast is set
+	CMDCLIENT	*m_dest;
+	bool	m_bcast;
+	// The lines coming in from the FPGA, and those going out to it
+	LINELOG	m_login, m_logout;
+
+	CMDMUX(int skt, int maxclients)
+			: m_topp(NETPP_RINGSZ), m_fromp(NETPP_RINGSZ),
+			m_login("Cmd-in"), m_logout("Cmd-out") {
+		m_skt = skt;
+		m_maxclients = maxclients;
+		if (m_maxclients > NETPP_MAXCLIENTS)
+			m_maxclients = NETPP_MAXCLIENTS;
+		m_passthru = (m_maxclients <= 1);
+		m_nclients = 0; m_next = 0; m_nextid = 0;
+		m_owner = NULL; m_dest = NULL; m_bcast = false;
 	}
 
-	void	print_in(FILE *fp, int ln, const char *prefix = NULL) {
-		// lbcmd.print_in(ncmd, (lbcmd.m_fd>=0)?"> ":"# ");
-		assert(ln > 0);
-		for(int i=0; i<ln; i++) {
-			m_iline[m_ilen++] = m_buf[i];
-			// printf("CH[%02x] = %c\n", m_buf[i], isgraph(m_buf[i])?m_buf[i]:'.');
-			bool	nl, fullline;
-			nl = (m_iline[m_ilen-1] == '\n');
-			nl=(nl)||(m_iline[m_ilen-1] == '\r');
-
-			fullline = ((unsigned)m_ilen >= sizeof(m_iline)-1);
-
-			if ((nl)||(fullline)) {
-				m_iline[m_ilen] = '\0';
-				fprintf(fp, "%s%s%s", // i, m_ilen,
-					(prefix)?prefix:"", m_iline, (!nl)?"\n":"");
-				m_ilen = 0;
+	virtual	void	event(int ep, unsigned events) { accept(ep); }
+	void	accept(int ep);
+	void	close(int ep, CMDCLIENT *c);
+	void	reap(int ep);
+	bool	arbitrate(void);
+	void	send(CMDCLIENT *c, int ln);
+	void	route(const char *buf, int ln);
+	void	tx(int ep);
+	void	update(int ep);
+};
+
+void	CMDCLIENT::event(int ep, unsigned events) {
+	if (m_closed)
+		return;
+	if (events & (EPOLLIN|EPOLLRDHUP|EPOLLERR))
+		rx();
+	if (events & EPOLLOUT)
+		tx();
+	if (events & (EPOLLHUP|EPOLLERR))
+		m_closed = true;
+}
+
+// Read whatever requests we have room for.  They'll wait here until it's our
+// turn to send them.
+void	CMDCLIENT::rx(void) {
+	int	nr;
+
+	if (m_reqlen >= NETPP_REQLN)
+		return;
+
+	nr = ::read(m_fd, &m_req[m_reqlen], NETPP_REQLN - m_reqlen);
+	if (nr == 0 || (nr < 0 && errno != EAGAIN))
+		m_closed = true;
+	else if (nr > 0)
+		m_reqlen += nr;
+}
+
+// Write out whatever responses the client will take
+void	CMDCLIENT::tx(void) {
+	char	buf[NETPP_CHUNK];
+	unsigned	nr;
+
+	while(!m_closed && (nr = m_rsp.peek(buf, sizeof(buf))) > 0) {
+		int nw = ::write(m_fd, buf, nr);
+		if (nw < 0 && errno == EAGAIN)
+			return;	// Wait for EPOLLOUT
+		else if (nw <= 0)
+			m_closed = true;
+		else
+			m_rsp.skip(nw);
+	}
+}
+
+void	CMDCLIENT::update(int ep) {
+	unsigned	events = 0;
+
+	if (m_reqlen < NETPP_REQLN)
+		events |= EPOLLIN | EPOLLRDHUP;
+	if (m_rsp.fill() > 0)
+		events |= EPOLLOUT;
+	if (events != m_events) {
+		m_events = events;
+		watch(ep, m_fd, EPOLL_CTL_MOD, events);
+	}
+}
+
+/*
+ * next
+ *
+ * Returns the length of the next group of requests that may be sent as one,
+ * or zero if there aren't any yet.  This is normally everything through the
+ * end of the next line.  If we've run out of room without seeing the end of
+ * a line, we'll instead take everything before the last command, since that
+ * command might still be waiting on more digits.
+ */
+int	CMDCLIENT::next(void) {
+	for(int i=0; i<m_reqlen; i++) {
+		char	ch = m_req[i] & 0x07f;
+
+		if ((ch == '\n')||(ch == '\r'))
+			return i+1;
+	}
+
+	if (m_reqlen < NETPP_REQLN)
+		return 0;
+
+	for(int i=m_reqlen-1; i>0; i--) {
+		if (isupper(m_req[i] & 0x07f))
+			return i;
+	}
+
+	return m_reqlen;
+}
+
+/*
+ * track
+ *
+ * Decode the requests in buf, much as hbpack within the RTL would, following
+ * them to see where they'll leave the bus address.  Returns the number of
+ * responses they'll produce: one for every address, read, or write.
+ *
+ * Since buf either ends a line, or is followed by another command, whatever
+ * command it ends with is known to be complete.
+ */
+int	CMDCLIENT::track(const char *buf, int ln) {
+	int	nrsp = 0;
+
+	for(int i=0; i<=ln; i++) {
+		char	ch = (i < ln) ? (buf[i] & 0x07f) : '\n';
+		int	d = -1;
+
+		if ((ch >= '0')&&(ch <= '9'))
+			d = ch - '0';
+		else if ((ch >= 'a')&&(ch <= 'f'))
+			d = ch - 'a' + 10;
+
+		if (d >= 0) {
+			// The first digit of an address is sign extended
+			if ((m_first)&&(m_cmd == 'A'))
+				m_word = (d & 8) ? (0xfffffff0u | d) : d;
+			else
+				m_word = (m_word << 4) | d;
+			m_first = false;
+			continue;
+		}
+
+		// Anything else completes the command before it
+		if (m_cmd == 'A') {
+			if (m_word & 2)
+				m_addr += m_word & -4;
+			else {
+				m_addr  = m_word & -4;
+				m_known = true;
 			}
+			m_inc = (m_word & 1) ? false : true;
+		}
+
+		m_cmd = 0;
+		if ((ch == 'A')||(ch == 'R')||(ch == 'W')) {
+			m_cmd = ch;
+			nrsp++;
+			if ((ch != 'A')&&(m_inc))
+				m_addr += 4;
 		}
+		m_word = 0;
+		m_first = true;
 	}
 
-	void	print_out(FILE *fp, int ln, const char *prefix = NULL) {
-		for(int i=0; i<ln; i++) {
-			m_oline[m_olen++] = m_buf[i] & 0x07f;
-			assert(m_buf[i] != '\0');
-			if ((m_oline[m_olen-1]=='\n')
-					||(m_oline[m_olen-1]=='\r')
-					||((unsigned)m_olen
-						>= sizeof(m_oline)-1)) {
-				if ((unsigned)m_olen >= sizeof(m_oline)-1)
-					m_oline[m_olen] = '\0';
-				else
-					m_oline[m_olen-1] = '\0';
-				if (m_olen > 1)
-					fprintf(fp,"%s%s\n",
-						(prefix)?prefix:"", m_oline);
-				m_olen = 0;
+	return nrsp;
+}
+
+void	CMDMUX::accept(int ep) {
+	int	fd = ::accept(m_skt, 0, 0);
+
+	if (fd < 0) {
+		perror("CMD Accept failed!  O/S Err:");
+		exit(EXIT_FAILURE);
+	} else if (m_nclients >= m_maxclients) {
+		netlog->printf(ALOG_INFO,
+			"Command port refused a client: too many clients");
+		::close(fd);
+		return;
+	}
+
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+	CMDCLIENT	*c = new CMDCLIENT(this, fd, m_nextid++);
+	m_client[m_nclients++] = c;
+	netlog->printf(ALOG_INFO, "Command client %d is now connected",
+		c->m_id);
+
+	c->m_events = EPOLLIN | EPOLLRDHUP;
+	c->watch(ep, fd, EPOLL_CTL_ADD, c->m_events);
+}
+
+void	CMDMUX::close(int ep, CMDCLIENT *c) {
+	epoll_ctl(ep, EPOLL_CTL_DEL, c->m_fd, NULL);
+	::close(c->m_fd);
+	netlog->printf(ALOG_INFO, "Command client %d closed", c->m_id);
+
+	// Any responses still to come for this client have nowhere to go
+	for(unsigned k=0; k<m_tags.size(); k++)
+		if (m_tags[k] == c)
+			m_tags[k] = NULL;
+	if (m_dest == c)
+		m_dest = NULL;
+	if (m_owner == c)
+		m_owner = NULL;
+
+	delete c;
+}
+
+// Remove any clients that have gone away.  This is only done once we're done
+// with every event, so no client is deleted while still in use.
+void	CMDMUX::reap(int ep) {
+	for(int k=0; k<m_nclients; k++) {
+		if (!m_client[k]->m_closed)
+			continue;
+		close(ep, m_client[k]);
+		for(int j=k+1; j<m_nclients; j++)
+			m_client[j-1] = m_client[j];
+		m_nclients--;
+		k--;
+	}
+}
+
+/*
+ * arbitrate
+ *
+ * Send the clients' requests to the port, taking turns, one line from each
+ * client in each turn.  We stop once the ring to the port is full, or there
+ * are already as many requests in flight as the FPGA can hold.  Returns true
+ * if anything was sent.
+ */
+bool	CMDMUX::arbitrate(void) {
+	bool	sent = true, any = false;
+
+	while(sent && m_nclients > 0) {
+		sent = false;
+		if (m_next >= m_nclients)
+			m_next = 0;
+		for(int n=0; n<m_nclients; n++) {
+			CMDCLIENT	*c = m_client[(m_next+n) % m_nclients];
+			int		ln, nrsp = 0;
+
+			if (c->m_closed || (ln = c->next()) == 0)
+				continue;
+			if (m_topp.room() < (unsigned)(ln + NETPP_ADDRLN))
+				return any;
+
+			if (!m_passthru) {
+				// Count the responses these requests will
+				// produce, without yet changing any state
+				for(int i=0; i<ln; i++) {
+					char	ch = c->m_req[i] & 0x07f;
+					if ((ch=='A')||(ch=='R')||(ch=='W'))
+						nrsp++;
+				}
+
+				// A client may always send its requests once
+				// the bus is idle, however many there are
+				if ((!m_tags.empty())&&(m_tags.size() + nrsp + 1
+						> NETPP_MAXINFLIGHT))
+					return any;
 			}
-		}
+
+			send(c, ln);
+			sent = any = true;
+		} m_next++;
 	}
 
-	void	flush_out(FILE *fp, const char *prefix = NULL) {
-		if(m_olen > 0) {
-			m_oline[m_olen] = '\0';
-			fprintf(fp, "%s%s\n", (prefix)?prefix:"", m_oline);
-			m_olen = 0;
+	return any;
+}
+
+/*
+ * send
+ *
+ * Send the first ln bytes of requests from client c to the port, tagging
+ * each request as we go.  If another client has moved the bus address since
+ * c last used it, put it back first.
+ */
+void	CMDMUX::send(CMDCLIENT *c, int ln) {
+	char	buf[NETPP_ADDRLN + NETPP_REQLN];
+	int	pos = 0, nrsp;
+
+	if ((!m_passthru)&&(m_owner != c)&&(c->m_known)) {
+		unsigned	a = c->m_addr | ((c->m_inc) ? 0:1);
+
+		// An absolute address.  Its first digit will be sign
+		// extended, so any of 8-f needs a zero in front of it.
+		pos = sprintf(buf, "A%x", a);
+		if ((pos < 9)&&(buf[1] >= '8')) {
+			memmove(&buf[2], &buf[1], pos);
+			buf[1] = '0';
+			pos++;
+		} buf[pos++] = '\n';
+		m_tags.push_back(NULL);
+	}
+
+	memcpy(&buf[pos], c->m_req, ln);
+	if (!m_passthru) {
+		nrsp = c->track(c->m_req, ln);
+		for(int k=0; k<nrsp; k++)
+			m_tags.push_back(c);
+	}
+
+	c->m_reqlen -= ln;
+	memmove(c->m_req, &c->m_req[ln], c->m_reqlen);
+	m_owner = c;
+
+	m_logout.add(buf, pos+ln, "< ");
+	for(int i=0; i<pos+ln; i++)
+		buf[i] |= 0x80;
+	m_topp.write(buf, pos+ln);
+}
+
+/*
+ * route
+ *
+ * Sort the responses from the FPGA among the clients.  Each response starts
+ * with a capital letter.  Those answering requests go to whoever's tag is
+ * next, and the rest go to everyone.  Digits and white space belong with the
+ * response before them.
+ */
+void	CMDMUX::route(const char *buf, int ln) {
+	for(int i=0; i<ln; i++) {
+		char	ch = buf[i];
+
+		if (m_passthru) {
+			m_bcast = true;
+		} else switch(ch) {
+		case 'A': case 'R': case 'K': case 'E':
+			if (m_tags.empty())
+				m_bcast = true;
+			else {
+				m_bcast = false;
+				m_dest  = m_tags.front();
+				m_tags.pop_front();
+			}
+			break;
+		case 'T':
+			// The bus has been reset, losing any requests in
+			// flight, along with its address
+			m_tags.clear();
+			m_owner = NULL;
+			m_bcast = true;
+			break;
+		case 'I': case 'Z': case 'S':
+			m_bcast = true;
+			break;
+		default:
+			break;
 		}
+
+		if (m_bcast) {
+			for(int k=0; k<m_nclients; k++)
+				m_client[k]->m_rsp.write(&ch, 1);
+		} else if (m_dest)
+			m_dest->m_rsp.write(&ch, 1);
 	}
-};
+}
 
+// Route whatever has come from the port, so long as every client has room for
+// it, and write out whatever each client will take.  Responses arriving for
+// nobody are logged, and then dropped.
+void	CMDMUX::tx(int ep) {
+	char	buf[NETPP_CHUNK];
 
-int main(int argc, char **argv)
-{
+	while(1) {
+		unsigned	ln = sizeof(buf), nr;
+		bool		stalled = m_fromp.room() < NETPP_CHUNK;
+
+		for(int k=0; k<m_nclients; k++)
+			if (m_client[k]->m_rsp.room() < ln)
+				ln = m_client[k]->m_rsp.room();
+
+		if (ln == 0 || (nr = m_fromp.read(buf, ln)) == 0)
+			break;
+		if (stalled)
+			notify(port_event);
+
+		route(buf, nr);
+		m_login.add(buf, nr, (m_nclients > 0) ? "> " : "# ");
+
+		for(int k=0; k<m_nclients; k++)
+			m_client[k]->tx();
+	}
+
+	for(int k=0; k<m_nclients; k++)
+		m_client[k]->tx();
+}
+
+void	CMDMUX::update(int ep) {
+	for(int k=0; k<m_nclients; k++)
+		if (!m_client[k]->m_closed)
+			m_client[k]->update(ep);
+}
+
+CMDMUX	*lbcmd;
+LINBUFS	*lbcon;
+
+/*
+ * port_thread
+ *
+ * Owns the parallel port.  Sends whatever the network thread has left in the
+ * rings to the port, and sorts whatever comes back from the FPGA into the
+ * rings from the port, spinning for as long as there's anything to do.
+ * Nothing is read from the FPGA unless there's room to hold it, so a slow
+ * network client backs up into the FPGA, rather than being lost.
+ */
+void	*port_thread(void *) {
+	char	buf[NETPP_CHUNK];
 	bool	last_busy = false;
 
-	// First, set ourselves up to listen on a variety of network ports
-	int	skt = setup_listener(FPGAPORT),
-		console = setup_listener(FPGAPORT+1);
-		// configuration socket = setup_listener(FPGAPORT+2); ??
-	bool	done = false;
+	while(1) {
+		bool		busy = false;
+		unsigned	nr, ln;
 
-	MUXDCOMMS	*pport = new MUXDCOMMS();
+		// Start by sending anything the network has for the FPGA,
+		// leaving in the rings whatever the port won't yet take
+		if ((nr = lbcmd->m_topp.peek(buf, sizeof(buf))) > 0) {
+			if ((nr = pport->write(nr, buf)) > 0) {
+				lbcmd->m_topp.skip(nr);
+				busy = true;
+			}
+		}
 
-	LINBUFS	lbcmd(pport), lbcon(pport);
-	while(!done) {
-		struct	pollfd	p[4];
-		int	pv, nfds;
-
-		//
-		// Set up a poll to see if we have any events to examine
-		//
-		nfds = 0;
-
-		if (lbcmd.m_connected) {
-			p[nfds].fd = lbcmd.m_fd;
-			p[nfds].events = POLLIN | POLLRDHUP | POLLERR;
-			nfds++;
-		} else {
-			p[nfds].fd = skt;
-			p[nfds].events = POLLIN | POLLERR;
-			nfds++;
+		if ((nr = lbcon->m_topp.peek(buf, sizeof(buf))) > 0) {
+			if ((nr = pport->write(nr, buf)) > 0) {
+				lbcon->m_topp.skip(nr);
+				busy = true;
+			}
 		}
 
-		if (lbcon.m_connected) {
-			p[nfds].fd = lbcon.m_fd;
-			p[nfds].events = POLLIN | POLLRDHUP | POLLERR;
-			nfds++;
+		// Then collect what the FPGA has for us, if there's room
+		ln = lbcmd->m_fromp.room();
+		if (ln > lbcon->m_fromp.room())
+			ln = lbcon->m_fromp.room();
+		if (ln > sizeof(buf))
+			ln = sizeof(buf);
+
+		nr = (ln > 0) ? pport->read(ln, buf) : 0;
+		if (nr > 0) {
+			for(unsigned i=0; i<nr; i++) {
+				char	ch = buf[i];
+
+				if (ch & 0x80) {
+					ch &= 0x07f;
+					lbcmd->m_fromp.write(&ch, 1);
+				} else
+					lbcon->m_fromp.write(&ch, 1);
+			}
+			busy = true;
+		}
+
+		if (busy) {
+			// Let the network thread know there's more for it,
+			// or more room for it
+			notify(net_event);
 		} else {
-			p[nfds].fd = console;
-			p[nfds].events = POLLIN | POLLERR;
-			nfds++;
+			int	wait_time;
+
+			if (!pport->is_idle())
+				wait_time = NO_WAITING;
+			else if (last_busy)
+				wait_time = SHORTWHILE;
+			else
+				wait_time = LONGWHILE;
+
+			if (wait_time != NO_WAITING) {
+				struct	pollfd	p;
+
+				p.fd = port_event;
+				p.events = POLLIN;
+				if (poll(&p, 1, wait_time) > 0)
+					clear_event(port_event);
+			}
 		}
 
-		int	wait_time;
-
-		if (!pport->is_idle()) {
-			wait_time = NO_WAITING;
-		} else if (last_busy) {
-			wait_time = SHORTWHILE;
-		} else
-			wait_time = LONGWHILE;
-		
-		if ((pv=poll(p, nfds, wait_time)) < 0) {
-			perror("Poll Failed!  O/S Err:");
-			exit(-1);
+		last_busy = busy;
+	}
+
+	return NULL;
+}
+
+void	usage(void) {
+	printf("USAGE: netpport [-x] [-c clients] [-g gpio] [-l level] [-o logfile]\n"
+"\n"
+"\tForwards the command and console ports of the FPGA, over the parallel\n"
+"\tport, to network ports %d and %d.\n"
+"\n"
+"\t-c clients\tThe most command port clients to serve at once [%d].\n"
+"\t\tTheir hexbus requests are interleaved a line at a time.\n"
+"\t\tWith one client, its bytes are passed through undecoded.\n"
+#if	defined(BINBUS_MASTER) || defined(WBU_MASTER)
+"\t\tThis build's debugging bus isn't hexbus, so only one\n"
+"\t\tclient is ever allowed.\n"
+#endif
+"\t-g gpio\tHow to drive the parallel port's GPIO lines, one of\n"
+"\t\tmmap\tThrough the GPIO registers themselves [default]\n"
+"\t\tsim\tNo hardware, but a model of the FPGA echoing\n"
+"\t\t\tevery byte back\n"
+#ifndef	NO_WIRINGPI
+"\t\twpi\tThrough wiringPi, one line at a time\n"
+#endif
+"\t-l level\tHow much to log: 0, nothing; 1, errors; 2, connections\n"
+"\t\tcoming and going; 3, every line of traffic as well [default]\n"
+"\t\tSIGUSR1 switches between 2 and 3, SIGUSR2 logs byte counts\n"
+"\t-o logfile\tLog to logfile, rather than to stdout\n"
+"\t-x\tExchange a byte with the FPGA for every byte sent, rather than\n"
+"\t\tsending bursts, for designs without a pport transmit FIFO\n"
+		, FPGAPORT, FPGAPORT+1, NETPP_DEFCLIENTS);
+}
+
+int main(int argc, char **argv)
+{
+	const char	*gpio = "mmap", *logfile = NULL;
+	bool	burst = true;
+	int	opt, loglevel = ALOG_DATA, maxclients = NETPP_DEFCLIENTS;
+
+	while((opt = getopt(argc, argv, "c:g:hl:o:x")) != -1) {
+		switch(opt) {
+		case 'c': maxclients = atoi(optarg); break;
+		case 'g': gpio = optarg; break;
+		case 'l': loglevel = atoi(optarg); break;
+		case 'o': logfile = optarg; break;
+		case 'x': burst = false; break;
+		case 'h': usage(); exit(EXIT_SUCCESS);
+		default:
+			usage();
+			exit(EXIT_FAILURE);
 		}
+	}
 
-		last_busy  = false;
+#if	defined(BINBUS_MASTER) || defined(WBU_MASTER)
+	if (maxclients > 1) {
+		fprintf(stderr, "ERR: Only one command client is supported, "
+			"unless the debugging bus is hexbus\n");
+		exit(EXIT_FAILURE);
+	}
+#endif
 
-		//
-		//
-		// Now we evaluate what just happened
-		//
-		//
+	PPGPIO	*pins = ppgpio_open(gpio);
+	if (NULL == pins) {
+		fprintf(stderr, "ERR: Unknown GPIO type, %s\n", gpio);
+		usage();
+		exit(EXIT_FAILURE);
+	}
 
-		// Start by flushing everything on the TTY channel
-		unsigned	nr;
-		char	rawbuf[256];
-		nr = pport->read(sizeof(rawbuf), rawbuf);
-		if (nr > 0) {
-			unsigned iterations = 0;
-			last_busy  = (nr == sizeof(rawbuf));
-			while(nr > 0) {
-				int	ncmd = 0, ncon = 0;
-				for(unsigned i=0; i<nr; i++) {
-					if (rawbuf[i] & 0x80)
-						lbcmd.m_buf[ncmd++] = rawbuf[i] & 0x07f;
-					else
-						lbcon.m_buf[ncon++] = rawbuf[i];
-				}
+	netlog = new ASYNCLOG(logfile, loglevel);
+	ASYNCLOG::signals(netlog);
 
-				/* printf("NR = %3d, NCMD = %3d, NCON = %3d", nr, ncmd, ncon);
-				printf(": %02x:%02x:%02x...\n",
-					lbcon.m_buf[0], lbcon.m_buf[1],
-					lbcon.m_buf[2]);
-				*/
-				if ((lbcmd.m_fd >= 0)&&(ncmd>0)) {
-					int	nw;
-					nw = lbcmd.write(lbcmd.m_fd, ncmd);
-					if(nw != ncmd) {
-					// This fails when the other end resets
-					// the connection.  Thus, we'll just
-					// kindly close the connection and skip
-					// the assert that once was at the end.
-					lbcmd.close();
-					}
-				}
+	// First, set ourselves up to listen on a variety of network ports
+	int	skt = setup_listener(FPGAPORT),
+		console = setup_listener(FPGAPORT+1);
+		// configuration socket = setup_listener(FPGAPORT+2); ??
+	bool	done = false;
+	int	ep;
+	pthread_t	port_id;
 
-				if ((lbcon.m_fd >= 0)&&(ncon>0)) {
-					int	nw;
-					nw = lbcon.write(lbcon.m_fd, ncon);
-					if(nw != ncon) {
-					// This fails when the other end resets
-					// the connection.  Thus, we'll just
-					// kindly close the connection and skip
-					// the assert that once was at the end.
-					lbcon.close();
-					}
-				}
+	signal(SIGPIPE, SIG_IGN);
 
-				if (ncmd > 0)
-					lbcmd.print_in(stdout, ncmd, (lbcmd.m_fd>=0)?"> ":"# ");
-				if (ncon > 0)
-					lbcon.print_in(stdout, ncon, (lbcon.m_fd >= 0)?") ":". ");
+	pport = new MUXDCOMMS(pins, burst);
+	lbcmd = new CMDMUX(skt, maxclients);
+	lbcon = new LINBUFS("Console", console);
 
-				if (iterations++ > 16)
-					break;
-				nr = pport->read(sizeof(rawbuf), rawbuf);
-			}
-		}
+	port_event = eventfd(0, EFD_NONBLOCK);
+	net_event  = eventfd(0, EFD_NONBLOCK);
+	ep = epoll_create1(0);
+	if ((port_event < 0)||(net_event < 0)||(ep < 0)) {
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
 
-		if (p[0].revents & POLLIN) {
-			if (p[0].fd == skt) {
-				lbcmd.accept(skt);
-				if (lbcmd.m_connected)
-					printf("Command port is now connected\n");
-			} else { // p[0].fd == lbcmd.m_fd
-				int nr = lbcmd.read();
-				if (nr == 0) {
-					lbcmd.flush_out(stdout, "< ");
-					// printf("Disconnect\n");
-					lbcmd.close();
-					pport->dump();
-					printf("Command port disconnect\n");
-				} else if (nr > 0) {
-					// printf("%d read from SKT\n", nr);
-					lbcmd.pp_write(nr, 0x80);
-					last_busy = true;
-					lbcmd.print_out(stdout, nr, "< ");
-				}
-			}
+	lbcmd->watch(ep, skt, EPOLL_CTL_ADD, EPOLLIN);
+	lbcon->watch(ep, console, EPOLL_CTL_ADD, EPOLLIN);
+	{
+		struct	epoll_event	ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = NULL;
+		epoll_ctl(ep, EPOLL_CTL_ADD, net_event, &ev);
+	}
+
+	if (pthread_create(&port_id, NULL, port_thread, NULL) != 0) {
+		fprintf(stderr, "ERR: Could not start the port thread\n");
+		exit(EXIT_FAILURE);
+	}
+
+	while(!done) {
+		struct	epoll_event	ev[NETPP_MAXCLIENTS+4];
+		int	nev;
+
+		if ((nev = epoll_wait(ep, ev, NETPP_MAXCLIENTS+4, FOREVER)) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("EPOLL Failed!  O/S Err:");
+			exit(EXIT_FAILURE);
 		}
 
-		if (p[1].revents & POLLIN) {
-			if (p[1].fd == console) {
-				lbcon.accept(console);
-				if (lbcon.m_connected)
-					printf("Console port is now connected\n");
-			} else { // p[1].fd == lbcon.m_fd
-				int nr = lbcon.read();
-				if (nr == 0) {
-					lbcon.flush_out(stdout);
-					lbcon.close();
-					pport->dump();
-					printf("Console port closed\n");
-				} else if (nr > 0) {
-					lbcon.pp_write(nr, 0x0);
-					last_busy = true;
-					lbcon.print_out(stdout, nr, "( ");
-				}
-			}
+		for(int k=0; k<nev; k++) {
+			NETWAITER	*w = (NETWAITER *)ev[k].data.ptr;
+
+			if (NULL == w)
+				clear_event(net_event);
+			else
+				w->event(ep, ev[k].events);
 		}
+
+		// Now, whatever woke us up, move what we can in both
+		// directions
+		if (lbcmd->arbitrate())
+			notify(port_event);
+		lbcmd->tx(ep);
+		lbcon->tx(ep);
+		lbcmd->reap(ep);
+		lbcmd->update(ep);
+		lbcon->update(ep);
 	}
 
-	printf("Closing our sockets\n");
+	netlog->printf(ALOG_INFO, "Closing our sockets");
 	close(console);
 	close(skt);
+	delete netlog;
 	return 0;
 }
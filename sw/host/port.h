@@ -44,6 +44,10 @@
 // #define	FPGAHOST	"rpi"
 #define	FPGAPORT	8363
 
+// Where the bus broker (busbroker) listens for its clients.  Give this as the
+// host (-n) to any program to share the broker's connection.
+#define	BROKERPATH	"/tmp/catzip-bus"
+
 #define	FPGAOPEN(V) V= new FPGA(new NETCOMMS(FPGAHOST, FPGAPORT))
 
 #endif
@@ -0,0 +1,354 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	ppgpio.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Implements the GPIO lines of the parallel port, as described
+//		in ppgpio.h: through the Pi's GPIO registers, through a
+//	software model of those registers, or through wiringPi.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "ppgpio.h"
+
+//
+// The parallel port, by BCM GPIO number.  See netpport.cpp for the connector
+// and FPGA pins these are found on.
+//
+#define	BCM_DIR		20
+#define	BCM_CLK		8
+#define	BCM_CLKFB	7
+static const int	bcm_data[8] = { 16, 19, 17, 5, 6, 23, 24, 18 };
+
+//
+// The GPIO register block, by word offset
+//
+#define	GPFSEL0		0
+#define	GPSET0		7
+#define	GPCLR0		10
+#define	GPLEV0		13
+#define	GPIO_BLKSZ	4096
+#define	GPIO_NWORDS	(GPIO_BLKSZ/sizeof(uint32_t))
+
+#define	BIT(N)		(1u << (N))
+
+/*
+ * pins_of
+ *
+ * Converts a GPLEV0 word into the format returned by PPGPIO::pins()
+ */
+static	unsigned	pins_of(uint32_t lv) {
+	unsigned	r = 0;
+
+	for(int k=0; k<8; k++)
+		r |= ((lv >> bcm_data[k])&1) << k;
+	if (lv & BIT(BCM_CLKFB))	r |= PP_CLKFB;
+	if (lv & BIT(BCM_CLK))		r |= PP_CLK;
+	if (lv & BIT(BCM_DIR))		r |= PP_DIR;
+	return r;
+}
+
+/*
+ * fsel
+ *
+ * Returns a GPFSEL word, v, with the mode of pin (0 for input, 1 for output)
+ * replaced, if that pin falls within the word numbered word.
+ */
+static	uint32_t	fsel(uint32_t v, int word, int pin, unsigned mode) {
+	if (pin / 10 != word)
+		return v;
+	pin = (pin % 10) * 3;
+	return (v & ~(7u << pin)) | (mode << pin);
+}
+
+MMAPGPIO::MMAPGPIO(const char *dev) {
+	void	*base;
+
+	m_fd = open(dev, O_RDWR | O_SYNC);
+	if (m_fd < 0) {
+		fprintf(stderr, "ERR: Could not open %s\n", dev);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	base = mmap(NULL, GPIO_BLKSZ, PROT_READ | PROT_WRITE, MAP_SHARED,
+			m_fd, 0);
+	if (base == MAP_FAILED) {
+		perror("GPIO MMAP Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	m_gpio = (volatile uint32_t *)base;
+	init();
+}
+
+MMAPGPIO::MMAPGPIO(volatile uint32_t *regs) {
+	m_fd   = -1;
+	m_gpio = regs;
+	init();
+}
+
+MMAPGPIO::~MMAPGPIO(void) {
+	if (m_fd >= 0) {
+		munmap((void *)m_gpio, GPIO_BLKSZ);
+		close(m_fd);
+	}
+}
+
+/*
+ * init
+ *
+ * Work out, once, every store we'll need to make: the function select words
+ * with the data lines as inputs and as outputs, and the set/clear bits for
+ * every byte.  Then set the port up as pp_init() once did: the direction and
+ * clock lines as (low) outputs, the feedback and data lines as inputs.  This
+ * assumes nothing else changes the mode of any of the other pins sharing
+ * GPFSEL0-2 with us while we run.
+ */
+void	MMAPGPIO::init(void) {
+	for(int w=0; w<3; w++) {
+		uint32_t	v = m_gpio[GPFSEL0+w];
+
+		v = fsel(v, w, BCM_DIR,   1);
+		v = fsel(v, w, BCM_CLK,   1);
+		v = fsel(v, w, BCM_CLKFB, 0);
+		m_fsel_in[w] = m_fsel_out[w] = v;
+		for(int k=0; k<8; k++) {
+			m_fsel_in[w]  = fsel(m_fsel_in[w],  w, bcm_data[k], 0);
+			m_fsel_out[w] = fsel(m_fsel_out[w], w, bcm_data[k], 1);
+		}
+	}
+
+	for(unsigned b=0; b<256; b++) {
+		m_bits[b] = 0;
+		for(int k=0; k<8; k++)
+			if (b & (1<<k))
+				m_bits[b] |= BIT(bcm_data[k]);
+	}
+
+	m_gpio[GPCLR0] = BIT(BCM_DIR) | BIT(BCM_CLK);
+	drive(false);
+}
+
+void	MMAPGPIO::ctrl(int dir, int clk) {
+	uint32_t	set = 0, clr = 0;
+
+	if (dir)	set |= BIT(BCM_DIR); else clr |= BIT(BCM_DIR);
+	if (clk)	set |= BIT(BCM_CLK); else clr |= BIT(BCM_CLK);
+	m_gpio[GPCLR0] = clr;
+	m_gpio[GPSET0] = set;
+}
+
+void	MMAPGPIO::clk(int v) {
+	if (v)
+		m_gpio[GPSET0] = BIT(BCM_CLK);
+	else
+		m_gpio[GPCLR0] = BIT(BCM_CLK);
+}
+
+void	MMAPGPIO::drive(bool out) {
+	const uint32_t	*v = (out) ? m_fsel_out : m_fsel_in;
+
+	m_gpio[GPFSEL0+0] = v[0];
+	m_gpio[GPFSEL0+1] = v[1];
+	m_gpio[GPFSEL0+2] = v[2];
+}
+
+void	MMAPGPIO::wrdata(unsigned byte, int clk) {
+	uint32_t	set = m_bits[byte & 0x0ff],
+			clr = m_bits[(~byte) & 0x0ff];
+
+	// Clear first, and set second, so that every data line has its
+	// new value by the time any rising clock gets out
+	if (clk)	set |= BIT(BCM_CLK); else clr |= BIT(BCM_CLK);
+	m_gpio[GPCLR0] = clr;
+	m_gpio[GPSET0] = set;
+}
+
+unsigned MMAPGPIO::pins(void) {
+	return pins_of(m_gpio[GPLEV0]);
+}
+
+//
+// SIMGPIO
+//
+// The register block is nothing more than memory here, so every access is
+// followed by a call to settle() to make the stores to it take effect.
+//
+SIMGPIO::SIMGPIO(void) : MMAPGPIO(new uint32_t[GPIO_NWORDS]()) {
+	m_out = 0;
+	m_clkfb = m_reading = false;
+	settle();
+}
+
+SIMGPIO::~SIMGPIO(void) {
+	delete[] (uint32_t *)m_gpio;
+}
+
+void	SIMGPIO::settle(void) {
+	uint32_t	lv, outputs = 0, pull;
+	bool		ck, dir;
+
+	m_out = (m_out & ~m_gpio[GPCLR0]) | m_gpio[GPSET0];
+	m_gpio[GPCLR0] = 0;
+	m_gpio[GPSET0] = 0;
+
+	for(int pin=0; pin<30; pin++)
+		if (((m_gpio[GPFSEL0 + pin/10] >> ((pin%10)*3)) & 7) == 1)
+			outputs |= BIT(pin);
+
+	ck  = (m_out & outputs & BIT(BCM_CLK)) != 0;
+	dir = (m_out & outputs & BIT(BCM_DIR)) != 0;
+
+	// Undriven lines float high
+	lv = (m_out & outputs) | ~outputs;
+
+	// The FPGA reacts to every edge of the clock, returning it as CLKFB
+	if ((ck)&&(!m_clkfb)) {
+		if (dir) {
+			// Received a byte.  Echo it back.
+			m_tx.push_back((char)(pins_of(lv) & PP_DATA));
+		} else
+			m_reading = true;
+		m_clkfb = true;
+	} else if ((!ck)&&(m_clkfb)) {
+		if ((m_reading)&&(!m_tx.empty()))
+			m_tx.pop_front();
+		m_reading = false;
+		m_clkfb = false;
+	}
+
+	if (!m_clkfb)
+		lv &= ~BIT(BCM_CLKFB);
+
+	// While the host is reading, the FPGA drives the data lines with the
+	// next byte it has to send, or all ones if it has nothing
+	if ((!dir)&&(!m_tx.empty())) {
+		pull = m_bits[(~m_tx.front()) & 0x0ff] & ~outputs;
+		lv &= ~pull;
+	}
+
+	m_gpio[GPLEV0] = lv;
+}
+
+void	SIMGPIO::ctrl(int dir, int clk) { MMAPGPIO::ctrl(dir, clk); settle(); }
+void	SIMGPIO::clk(int v) { MMAPGPIO::clk(v); settle(); }
+void	SIMGPIO::drive(bool out) { MMAPGPIO::drive(out); settle(); }
+void	SIMGPIO::wrdata(unsigned byte, int clk) {
+	MMAPGPIO::wrdata(byte, clk); settle(); }
+unsigned SIMGPIO::pins(void) { settle(); return MMAPGPIO::pins(); }
+
+#ifndef	NO_WIRINGPI
+#include <wiringPi.h>
+
+//
+// For reference, here are four valuable definitions found within wiringPi.h
+//
+// #define	LOW	0
+// #define	HIGH	1
+// #define	INPUT	0
+// #define	OUTPUT	1
+
+//
+// The same lines, by wiringPi number
+//
+#  define RASPI_DIR 28
+#  define RASPI_CLK 10
+#  define RASPI_CLKFB 11
+static const int	wpi_data[8] = { 27, 24, 0, 21, 22, 4, 5, 1 };
+
+WPIGPIO::WPIGPIO(void) {
+	// Initialize the wiringPi library
+	wiringPiSetup();
+
+	// Comms take place over 8 bidirectional data bits, a clock,
+	// and a direction bit
+
+	pinMode(RASPI_DIR, OUTPUT);
+	digitalWrite(RASPI_DIR, OUTPUT);
+	pinMode(RASPI_CLK, OUTPUT);
+	digitalWrite(RASPI_CLK, 0);
+	pinMode(RASPI_CLKFB, INPUT);
+	drive(false);
+	digitalWrite(RASPI_DIR, INPUT);
+}
+
+void	WPIGPIO::ctrl(int dir, int clk) {
+	digitalWrite(RASPI_DIR, dir);
+	digitalWrite(RASPI_CLK, clk);
+}
+
+void	WPIGPIO::clk(int v) {
+	digitalWrite(RASPI_CLK, v);
+}
+
+void	WPIGPIO::drive(bool out) {
+	for(int k=7; k>=0; k--)
+		pinMode(wpi_data[k], (out) ? OUTPUT : INPUT);
+}
+
+void	WPIGPIO::wrdata(unsigned byte, int clk) {
+	for(int k=7; k>=0; k--)
+		digitalWrite(wpi_data[k], (byte >> k)&1);
+	digitalWrite(RASPI_CLK, clk);
+}
+
+unsigned WPIGPIO::pins(void) {
+	unsigned	r = 0;
+
+	for(int k=7; k>=0; k--)
+		if (digitalRead(wpi_data[k]))
+			r |= (1<<k);
+	if (digitalRead(RASPI_CLKFB))	r |= PP_CLKFB;
+	if (digitalRead(RASPI_CLK))	r |= PP_CLK;
+	if (digitalRead(RASPI_DIR))	r |= PP_DIR;
+	return r;
+}
+#endif
+
+PPGPIO	*ppgpio_open(const char *name) {
+	if (0 == strcmp(name, "mmap"))
+		return new MMAPGPIO();
+	else if (0 == strcmp(name, "sim"))
+		return new SIMGPIO();
+#ifndef	NO_WIRINGPI
+	else if (0 == strcmp(name, "wpi"))
+		return new WPIGPIO();
+#endif
+	return NULL;
+}
@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	ppgpio.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	The GPIO lines making up the parallel port between a Raspberry
+//		Pi and the iCE40, hidden behind an interface so that netpport
+//	doesn't need to care how they are driven.  Three implementations are
+//	provided:
+//
+//	MMAPGPIO drives the lines through the Pi's GPIO register block, mapped
+//		into our address space from /dev/gpiomem.  All eight data bits
+//		and the clock are set and cleared together, with one store to
+//		GPSET0 and one to GPCLR0, and all of the lines are read with a
+//		single load of GPLEV0.
+//	SIMGPIO is a software model of that register block, together with a
+//		model of the FPGA's side of the port, so that MMAPGPIO (and
+//		netpport with it) can be exercised on a PC.  The model FPGA
+//		echoes every byte it receives back to the host.
+//	WPIGPIO is the original wiringPi implementation, moving one bit at a
+//		time.  It's left out of builds made with NO_WIRINGPI defined.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	PPGPIO_H
+#define	PPGPIO_H
+
+#include <stdint.h>
+#include <deque>
+
+#define	READ_FROM_ICO	0
+#define	WRITE_TO_ICO	1
+
+// The bits returned by PPGPIO::pins()
+#define	PP_DATA		0x0ff
+#define	PP_CLKFB	0x100
+#define	PP_CLK		0x200
+#define	PP_DIR		0x400
+
+class	PPGPIO {
+public:
+	virtual	~PPGPIO(void) {}
+
+	// Set the direction (READ_FROM_ICO or WRITE_TO_ICO) and clock lines
+	virtual	void	ctrl(int dir, int clk) = 0;
+	// Set the clock line alone
+	virtual	void	clk(int v) = 0;
+	// Turn the data lines into outputs (drive == true) or inputs
+	virtual	void	drive(bool out) = 0;
+	// Place a byte on the data lines and set the clock, both at once.  The
+	// data lines are set up no later than the clock rises.
+	virtual	void	wrdata(unsigned byte, int clk) = 0;
+	// Read every line at once, returning the data lines in the bottom
+	// eight bits, together with PP_CLKFB, PP_CLK and PP_DIR
+	virtual	unsigned	pins(void) = 0;
+};
+
+class	MMAPGPIO : public PPGPIO {
+protected:
+	volatile uint32_t	*m_gpio;
+	int		m_fd;
+	// The values of GPFSEL0-2, with the data lines as inputs or outputs
+	uint32_t	m_fsel_in[3], m_fsel_out[3];
+	// The GPSET0/GPCLR0 bits for every byte we might write
+	uint32_t	m_bits[256];
+
+	// Used by SIMGPIO, to run on top of memory of its own
+	MMAPGPIO(volatile uint32_t *regs);
+	void	init(void);
+public:
+	MMAPGPIO(const char *dev = "/dev/gpiomem");
+	virtual	~MMAPGPIO(void);
+
+	virtual	void	ctrl(int dir, int clk);
+	virtual	void	clk(int v);
+	virtual	void	drive(bool out);
+	virtual	void	wrdata(unsigned byte, int clk);
+	virtual	unsigned	pins(void);
+};
+
+class	SIMGPIO : public MMAPGPIO {
+	// The values last written to the output lines
+	uint32_t	m_out;
+	// Our model of the FPGA: its clock feedback, whether the host is
+	// clocking out a byte from it, and the bytes it has yet to send
+	bool		m_clkfb, m_reading;
+	std::deque<char>	m_tx;
+
+	// Apply any stores to GPSET0 and GPCLR0, let the FPGA react, and
+	// update GPLEV0 to match
+	void	settle(void);
+public:
+	SIMGPIO(void);
+	virtual	~SIMGPIO(void);
+
+	virtual	void	ctrl(int dir, int clk);
+	virtual	void	clk(int v);
+	virtual	void	drive(bool out);
+	virtual	void	wrdata(unsigned byte, int clk);
+	virtual	unsigned	pins(void);
+};
+
+#ifndef	NO_WIRINGPI
+class	WPIGPIO : public PPGPIO {
+public:
+	WPIGPIO(void);
+
+	virtual	void	ctrl(int dir, int clk);
+	virtual	void	clk(int v);
+	virtual	void	drive(bool out);
+	virtual	void	wrdata(unsigned byte, int clk);
+	virtual	unsigned	pins(void);
+};
+#endif
+
+// Returns the GPIO implementation by name, "mmap", "sim", or "wpi", or NULL
+// if there's no such implementation
+extern	PPGPIO	*ppgpio_open(const char *name);
+
+#endif
@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	profdata.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	The format of a ZipCPU profile, as written by the simulator's
+//		PCPROF (main_tb -f) and read by zipprof.  The file is a PROFHDR,
+//	followed by m_npcs PROFPC records, one for every instruction address
+//	the CPU ever stopped at, and then m_narcs PROFARC records, one for
+//	every place the CPU was seen to call from and to.
+//
+//	All values are written in the byte order of the host that wrote them.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	PROFDATA_H
+#define	PROFDATA_H
+
+#include <stdint.h>
+
+#define	PROF_MAGIC	0x5a50524f	// "ZPRO"
+#define	PROF_VERSION	2
+
+// Set in m_flags if the profile was built by sampling the PC of a running
+// CPU, as by zipsample, rather than by counting every clock tick.  Each
+// sample is then counted as retired, there are no stalls, and m_ticks
+// counts samples rather than ticks.
+#define	PROF_SAMPLED	1
+
+typedef	struct	{
+	uint32_t	m_magic, m_version;
+	uint32_t	m_npcs, m_narcs;
+	uint32_t	m_flags, m_unused;
+	uint64_t	m_ticks;	// Clock ticks profiled
+} PROFHDR;
+
+// Every clock tick is charged to one instruction: either it retired on that
+// tick, or it was still waiting to retire, and so the tick was a stall.
+typedef	struct	{
+	uint32_t	m_pc, m_unused;
+	uint64_t	m_retired, m_stalls;
+} PROFPC;
+
+// A call, from the branch at m_site, to the function at m_entry.  m_cycles
+// counts the clock ticks from the call until its return, including those
+// spent in any functions it called in turn.
+typedef	struct	{
+	uint32_t	m_site, m_entry;
+	uint64_t	m_calls, m_cycles;
+} PROFARC;
+
+#endif
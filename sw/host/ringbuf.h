@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	ringbuf.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	A lock-free ring buffer of bytes, for passing data from one
+//		thread to another.  There may only be one thread writing to
+//	any given ring, and only one thread reading from it.  Neither ever
+//	blocks: write() accepts only as much as there's room for, and read()
+//	returns only what's there.  It's up to the caller to decide what to do
+//	when the ring is full or empty.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#ifndef	RINGBUF_H
+#define	RINGBUF_H
+
+#include <string.h>
+#include <atomic>
+
+class	RINGBUF {
+	char	*m_buf;
+	unsigned	m_size;	// A power of two
+	// m_head counts every byte ever written, m_tail every byte ever read.
+	// Only the writer changes m_head, and only the reader changes m_tail.
+	std::atomic<unsigned>	m_head, m_tail;
+
+	// Copy ln bytes, at position pos of the ring, either into or out of
+	// buf, wrapping around the end of the ring as necessary
+	void	copy(unsigned pos, char *buf, unsigned ln, bool in) {
+		unsigned	first = pos & (m_size-1), n1 = ln;
+
+		if (first + n1 > m_size)
+			n1 = m_size - first;
+		if (in) {
+			memcpy(&m_buf[first], buf, n1);
+			memcpy(m_buf, &buf[n1], ln - n1);
+		} else {
+			memcpy(buf, &m_buf[first], n1);
+			memcpy(&buf[n1], m_buf, ln - n1);
+		}
+	}
+public:
+	RINGBUF(unsigned sz = 65536) : m_head(0), m_tail(0) {
+		for(m_size = 1; m_size < sz; m_size <<= 1)
+			;
+		m_buf = new char[m_size];
+	}
+
+	~RINGBUF(void) { delete[] m_buf; }
+
+	// The number of bytes waiting to be read, and the room left to write
+	// them.  The other thread may change either at any time, but only
+	// ever by making more room for the writer, or more to read for the
+	// reader.
+	unsigned	fill(void) const {
+		return m_head.load(std::memory_order_acquire)
+			- m_tail.load(std::memory_order_acquire); }
+	unsigned	room(void) const { return m_size - fill(); }
+
+	// Write up to ln bytes into the ring, returning the number written
+	unsigned	write(const char *buf, unsigned ln) {
+		unsigned	head = m_head.load(std::memory_order_relaxed),
+				rm = room();
+
+		if (ln > rm)
+			ln = rm;
+		copy(head, (char *)buf, ln, true);
+		m_head.store(head + ln, std::memory_order_release);
+		return ln;
+	}
+
+	// Copy up to ln bytes from the ring, without removing them, returning
+	// the number copied
+	unsigned	peek(char *buf, unsigned ln) {
+		unsigned	tail = m_tail.load(std::memory_order_relaxed),
+				fl = fill();
+
+		if (ln > fl)
+			ln = fl;
+		copy(tail, buf, ln, false);
+		return ln;
+	}
+
+	// Remove ln bytes, already peek()ed, from the ring
+	void	skip(unsigned ln) {
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + ln,
+			std::memory_order_release);
+	}
+
+	// Read up to ln bytes from the ring, returning the number read
+	unsigned	read(char *buf, unsigned ln) {
+		ln = peek(buf, ln);
+		skip(ln);
+		return ln;
+	}
+};
+
+#endif
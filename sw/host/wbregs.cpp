@@ -50,6 +50,7 @@
 #include "port.h"
 #include "regdefs.h"
 #include "hexbus.h"
+#include "busqueue.h"
 
 FPGA	*m_fpga;
 void	closeup(int v) {
@@ -137,8 +138,203 @@ char	*getmap_name(const char *map_fname, const unsigned val) {
 	return NULL;
 }
 
+/*
+ * getaddress
+ *
+ * Turn an address, given either as a value or a register name, into the
+ * address itself, finding a name for it along the way.
+ */
+unsigned getaddress(const char *map_file, const char *named_address,
+		const char **nm) {
+	unsigned	address;
+
+	*nm = NULL;
+	if (isvalue(named_address)) {
+		address = strtoul(named_address, NULL, 0);
+		if (map_file)
+			*nm = getmap_name(map_file, address);
+		if (*nm == NULL)
+			*nm = addrname(address);
+	} else if (map_file) {
+		address = getmap_address(map_file, named_address);
+		*nm = getmap_name(map_file, address);
+		if (!*nm) {
+			address = addrdecode(named_address);
+			*nm = addrname(address);
+		}
+	} else {
+		address = addrdecode(named_address);
+		*nm = addrname(address);
+	}
+
+	if (NULL == *nm)
+		*nm = "";
+	return address;
+}
+
+// How long (in ms) a wait within a script will wait by default
+#define	WAIT_TIMEOUT	5000
+
+/*
+ * reportwrites
+ *
+ * Run any writes still queued, and report on each of them.  Returns the
+ * number that failed.
+ */
+int	reportwrites(BUSQUEUE &q, int nw, const BUSQUEUE::HANDLE *wh,
+		const unsigned *wa, const unsigned *wv) {
+	int	nerr = 0;
+
+	q.flush();
+	for(int k=0; k<nw; k++) {
+		if (q.err(wh[k])) {
+			printf("ERR 0x%08x\n", wa[k]);
+			nerr++;
+		} else
+			printf("W 0x%08x 0x%08x\n", wa[k], wv[k]);
+	}
+
+	return nerr;
+}
+
+/*
+ * runscript
+ *
+ * Run a script of bus operations, one per line, all over the one
+ * connection:
+ *
+ *	address			Read from address
+ *	address value		Write value to address
+ *	wait address value [mask [timeout]]
+ *				Read address until (v & mask) == value, giving
+ *				up after timeout ms
+ *	sleep ms		Pause for ms milliseconds
+ *
+ * Addresses may be given by name, just as on the command line.  Anything
+ * following a '#' is a comment.  Writes are queued until the next read, wait,
+ * or sleep, so that a run of them costs no more than a single round trip.
+ *
+ * Every operation prints one line, in a form easy for another program to
+ * read:
+ *
+ *	R address value
+ *	W address value
+ *	WAIT address value OK
+ *	WAIT address value TIMEOUT
+ *	ERR address
+ *
+ * Returns the number of operations that failed.
+ */
+int	runscript(FILE *fp, const char *map_file) {
+	BUSQUEUE	q(m_fpga);
+	char		line[512];
+	int		lineno = 0, nerr = 0, nw = 0;
+	BUSQUEUE::HANDLE	wh[BUSQ_DEFAULTSZ];
+	unsigned	wa[BUSQ_DEFAULTSZ], wv[BUSQ_DEFAULTSZ];
+
+	while(fgets(line, sizeof(line), fp)) {
+		char		*tok[5], *ptr;
+		int		ntok = 0;
+		const char	*nm;
+		bool		sleep_op, wait_op;
+
+		lineno++;
+		if ((ptr = strchr(line, '#')) != NULL)
+			*ptr = '\0';
+		for(ptr = strtok(line, " \t\r\n"); (ptr)&&(ntok < 5);
+				ptr = strtok(NULL, " \t\r\n"))
+			tok[ntok++] = ptr;
+		if (ntok == 0)
+			continue;
+
+		sleep_op = (strcasecmp(tok[0], "sleep") == 0);
+		wait_op  = (strcasecmp(tok[0], "wait") == 0);
+
+		if ((ntok == 2)&&(!sleep_op)&&(!wait_op)) {
+			// Writes are queued, so long as the queue can still
+			// tell us how they went
+			if (nw >= BUSQ_DEFAULTSZ) {
+				nerr += reportwrites(q, nw, wh, wa, wv);
+				nw = 0;
+			}
+
+			wa[nw] = getaddress(map_file, tok[0], &nm);
+			wv[nw] = strtoul(tok[1], NULL, 0);
+			wh[nw] = q.writeio(wa[nw], wv[nw]);
+			nw++;
+			continue;
+		}
+
+		// Anything else waits on the writes before it
+		nerr += reportwrites(q, nw, wh, wa, wv);
+		nw = 0;
+
+		if ((ntok == 1)&&(!sleep_op)&&(!wait_op)) {
+			BUSQUEUE::HANDLE	h;
+			unsigned		a;
+
+			a = getaddress(map_file, tok[0], &nm);
+			h = q.readio(a);
+			q.wait(h);
+			if (q.err(h)) {
+				printf("ERR 0x%08x\n", a);
+				nerr++;
+			} else
+				printf("R 0x%08x 0x%08x\n", a, q.value(h));
+		} else if ((ntok == 2)&&(sleep_op)) {
+			fflush(stdout);
+			usleep(1000 * strtoul(tok[1], NULL, 0));
+		} else if ((ntok >= 3)&&(wait_op)) {
+			unsigned	a, v, mask = 0xffffffff, rd = 0;
+			unsigned	timeout = WAIT_TIMEOUT, ms = 0;
+			bool		err = false;
+
+			a = getaddress(map_file, tok[1], &nm);
+			v = strtoul(tok[2], NULL, 0);
+			if (ntok > 3)
+				mask = strtoul(tok[3], NULL, 0);
+			if (ntok > 4)
+				timeout = strtoul(tok[4], NULL, 0);
+
+			while(1) {
+				try {
+					rd = m_fpga->readio(a);
+				} catch(BUSERR b) {
+					err = true;
+					break;
+				}
+
+				if (((rd & mask) == v)||(ms >= timeout))
+					break;
+				usleep(1000);
+				ms++;
+			}
+
+			if (err) {
+				printf("ERR 0x%08x\n", a);
+				nerr++;
+			} else if ((rd & mask) == v)
+				printf("WAIT 0x%08x 0x%08x OK\n", a, v);
+			else {
+				printf("WAIT 0x%08x 0x%08x TIMEOUT\n", a, v);
+				nerr++;
+			}
+		} else {
+			fprintf(stderr, "ERR: Unknown operation on line %d\n",
+				lineno);
+			nerr++;
+		}
+	}
+
+	// Report on any writes left at the end of the script
+	nerr += reportwrites(q, nw, wh, wa, wv);
+
+	return nerr;
+}
+
 void	usage(void) {
 	printf("USAGE: wbregs [-d] address [value]\n"
+"       wbregs -f script\n"
 "\n"
 "\tWBREGS stands for Wishbone registers.  It is designed to allow a\n"
 "\tuser to peek and poke at registers within a given FPGA design, so\n"
@@ -149,6 +345,10 @@ void	usage(void) {
 "\t-d\tIf given, specifies the value returned should be in decimal,\n"
 "\t\trather than hexadecimal.\n"
 "\n"
+"\t-f [file]\tRun the script of reads, writes, waits and sleeps found\n"
+"\t\tin [file] (or stdin, if [file] is -), all over one connection.\n"
+"\t\tSee runscript() in wbregs.cpp for its format.\n"
+"\n"
 "\t-n [host]\tAttempt to connect, via TCP/IP, to host named [host].\n"
 "\t\tThe default host is \'%s\'\n"
 "\n"
@@ -166,7 +366,7 @@ void	usage(void) {
 int main(int argc, char **argv) {
 	int	skp=0;
 	bool	use_decimal = false;
-	char	*map_file = NULL;
+	char	*map_file = NULL, *script = NULL;
 	const char *host = FPGAHOST;
 	int	port=FPGAPORT;
 
@@ -175,27 +375,34 @@ int main(int argc, char **argv) {
 		if (argv[argn+skp][0] == '-') {
 			if (argv[argn+skp][1] == 'd') {
 				use_decimal = true;
+			} else if (argv[argn+skp][1] == 'f') {
+				if (argn+skp+1 >= argc) {
+					fprintf(stderr, "ERR: No script file given\n");
+					exit(EXIT_SUCCESS);
+				}
+				script = argv[argn+skp+1];
+				skp++;
 			} else if (argv[argn+skp][1] == 'm') {
 				if (argn+skp+1 >= argc) {
 					fprintf(stderr, "ERR: No Map file given\n");
 					exit(EXIT_SUCCESS);
 				}
 				map_file = argv[argn+skp+1];
-				skp++; argn--;
+				skp++;
 			} else if (argv[argn+skp][1] == 'n') {
 				if (argn+skp+1 >= argc) {
 					fprintf(stderr, "ERR: No network host given\n");
 					exit(EXIT_SUCCESS);
 				}
 				host = argv[argn+skp+1];
-				skp++; argn--;
+				skp++;
 			} else if (argv[argn+skp][1] == 'p') {
 				if (argn+skp+1 >= argc) {
 					fprintf(stderr, "ERR: No network port # given\n");
 					exit(EXIT_SUCCESS);
 				}
 				port = strtoul(argv[argn+skp+1], NULL, 0);
-				skp++; argn--;
+				skp++;
 			} else {
 				usage();
 				exit(EXIT_SUCCESS);
@@ -210,41 +417,41 @@ int main(int argc, char **argv) {
 	signal(SIGSTOP, closeup);
 	signal(SIGHUP, closeup);
 
-	if ((argc < 1)||(argc > 2)) {
-		// usage();
-		printf("USAGE: wbregs address [value]\n");
-		exit(-1);
-	}
-
 	if ((map_file)&&(access(map_file, R_OK)!=0)) {
 		fprintf(stderr, "ERR: Cannot open/read map file, %s\n", map_file);
 		perror("O/S Err:");
 		exit(EXIT_FAILURE);
 	}
 
-	const char *nm = NULL, *named_address = argv[0];
-	unsigned address, value;
+	if (script) {
+		FILE	*fp = stdin;
+		int	nerr;
 
-	if (isvalue(named_address)) {
-		address = strtoul(named_address, NULL, 0);
-		if (map_file)
-			nm = getmap_name(map_file, address);
-		if (nm == NULL)
-			nm = addrname(address);
-	} else if (map_file) {
-		address = getmap_address(map_file, named_address);
-		nm = getmap_name(map_file, address);
-		if (!nm) {
-			address = addrdecode(named_address);
-			nm = addrname(address);
+		if (strcmp(script, "-") != 0)
+			fp = fopen(script, "r");
+		if (NULL == fp) {
+			fprintf(stderr, "ERR: Cannot open script, %s\n", script);
+			perror("O/S Err:");
+			exit(EXIT_FAILURE);
 		}
-	} else {
-		address = addrdecode(named_address);
-		nm = addrname(address);
+
+		nerr = runscript(fp, map_file);
+		if (fp != stdin)
+			fclose(fp);
+		delete	m_fpga;
+		exit((nerr == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
 	}
 
-	if (NULL == nm)
-		nm = "";
+	if ((argc < 1)||(argc > 2)) {
+		// usage();
+		printf("USAGE: wbregs address [value]\n");
+		exit(-1);
+	}
+
+	const char *nm = NULL;
+	unsigned address, value;
+
+	address = getaddress(map_file, argv[0], &nm);
 
 	if (argc < 2) {
 		FPGA::BUSW	v;
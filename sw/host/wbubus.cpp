@@ -0,0 +1,846 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	wbubus.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	This is the C++ program on the command side that will interact
+//		with the compressing wbubus on an FPGA, to command the WISHBONE
+//	on that same FPGA to ... whatever we wish to command it to do.
+//
+//	Everything is sent as printable characters, each carrying six bits:
+//	0-9 for 0-9, A-Z for 10-35, a-z for 36-61, '@' for 62 and '%' for 63.
+//	Newlines separate words, but carry no information.  Commands are:
+//
+//		00 00aa + 5 chars	Set the (word) address to a[31:0]
+//		00 1lls + (l+1) chars	Set a compressed address of 6(l+1) bits,
+//					relative to the last if s is set
+//		01 0kki + 1 char	Write the value last written k[7:0] values
+//					ago
+//		01 1ddi + 5 chars	Write d[31:0]
+//		10 llli			Read (l+1) values
+//		11 llli + 1 char	Read (9+l[8:0]) values
+//
+//	where i is set if the address is to increment after every access.  A
+//	newline following a write ends the bus cycle.
+//
+//	Responses are:
+//
+//		00 0000		Idle
+//		00 0001		Bus busy (idle, but with the bus cycle held)
+//		00 0010		Write acknowledgement
+//		00 0011		Bus reset
+//		00 0100		Interrupt
+//		00 0101		Bus error
+//		00 011i		Read the same value as the last one read
+//		00 10aa + 5 chars	Address a[31:0]
+//		00 11ll + (l+1) chars	Address, compressed to 6(l+1) bits
+//		01 kkki + 1 char	Read the value read k+10 values ago
+//		10 kkki		Read the value read k+2 values ago
+//		11 1ddi + 5 chars	Read d[31:0]
+//
+//	Only values read in full count towards "values ago", and that count
+//	starts over with every address returned.
+//
+//	This code does not run on an FPGA, is not a test bench, neither is it a
+//	simulator.  It is a portion of a command program for commanding an FPGA.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "wbubus.h"
+
+// Response codes, the first character of any response
+#define	WBUB_IDLE	0
+#define	WBUB_BUSBUSY	1
+#define	WBUB_ACK	2
+#define	WBUB_RESET	3
+#define	WBUB_INT	4
+#define	WBUB_ERR	5
+
+//
+// As with the HEXBUS, you can define DBGPRINTF to be either printf or
+// filedump (both found in hexbus.cpp) to trace what's going on.
+//
+// #define	DBGPRINTF	printf
+// #define	DBGPRINTF	filedump
+//
+#ifndef	DBGPRINTF
+#define	DBGPRINTF	null
+#else
+#warning "WBUBUS DEBUG IS TURNED ON"
+#endif
+
+extern	void	null(...);
+extern	void	filedump(const char *fmt, ...);
+
+static	const	char	wbub_charenc[] =
+	"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz@%";
+
+/*
+ * wbub_chardec
+ *
+ * Convert a character from the FPGA back into the six bits it represents,
+ * or return -1 if it doesn't represent any.
+ */
+static	int	wbub_chardec(const char ch) {
+	if ((ch >= '0')&&(ch <= '9'))
+		return ch - '0';
+	else if ((ch >= 'A')&&(ch <= 'Z'))
+		return ch - 'A' + 10;
+	else if ((ch >= 'a')&&(ch <= 'z'))
+		return ch - 'a' + 36;
+	else if (ch == '@')
+		return 62;
+	else if (ch == '%')
+		return 63;
+	return -1;
+}
+
+/*
+ * lclreadcode
+ *
+ * Read from our interface, and drop any idle characters (bottom seven bits
+ * set) from any interaction.
+ */
+int	WBUBUS::lclreadcode(char *buf, int len) {
+	int	nr, nv = 0;
+
+	nr = m_dev->read(buf, len);
+	m_total_nread += nr;
+	for(int i=0; i<nr; i++) {
+		if ((buf[i]&0x7f)!=0x7f)
+			buf[nv++] = buf[i] & 0x7f;
+	} return nv;
+}
+
+/*
+ * bufalloc
+ *
+ * Allocate a buffer of at least length (len).  This is similar to realloc().
+ *
+ */
+void	WBUBUS::bufalloc(int len) {
+	if ((m_buf)&&(m_buflen >= len))
+		return;
+	if (m_buf)
+		delete[] m_buf;
+	m_buflen = (len&(-0x3f))+0x40;
+	m_buf = new char[m_buflen];
+}
+
+/*
+ * writeio
+ *
+ * Write a single value to the debugging interface
+ */
+void	WBUBUS::writeio(const BUSW a, const BUSW v) {
+	writev(a, 0, 1, &v);
+	m_lastaddr = a; m_addr_set = true;
+}
+
+/*
+ * encode_write
+ *
+ * Places the write command for the value v into the buffer at ptr, returning
+ * a pointer to the character following.  If we've written this value
+ * recently, we send its position within the FPGA's table of recently written
+ * values rather than the value itself.
+ */
+char	*WBUBUS::encode_write(char *ptr, const BUSW v, const int inc) {
+	unsigned	ntbl = m_wrtbl_valid;
+
+	// The value at wr_addr within the FPGA's table isn't valid, so we can
+	// only look back WBUB_WRTBLSZ-1 values
+	if (ntbl > WBUB_WRTBLSZ-1)
+		ntbl = WBUB_WRTBLSZ-1;
+	for(unsigned k=1; k<=ntbl; k++) {
+		if (m_wrtbl[(m_wrtbl_addr-k)&(WBUB_WRTBLSZ-1)] == v) {
+			*ptr++ = wbub_charenc[0x10|((k>>5)&6)|(inc?1:0)];
+			*ptr++ = wbub_charenc[k&0x3f];
+			return ptr;
+		}
+	}
+
+	*ptr++ = wbub_charenc[0x18|((v>>29)&6)|(inc?1:0)];
+	for(int s=24; s>=0; s-=6)
+		*ptr++ = wbub_charenc[(v>>s)&0x3f];
+
+	m_wrtbl[(m_wrtbl_addr++)&(WBUB_WRTBLSZ-1)] = v;
+	if (m_wrtbl_valid < WBUB_WRTBLSZ)
+		m_wrtbl_valid++;
+	return ptr;
+}
+
+/*
+ * encode_read
+ *
+ * Places a command to read len values, 1 <= len <= WBUB_MAXRDLEN, into the
+ * buffer at ptr, returning a pointer to the character following.
+ */
+char	*WBUBUS::encode_read(char *ptr, const int len, const int inc) {
+	if (len <= 8)
+		*ptr++ = wbub_charenc[0x20|((len-1)<<1)|(inc?1:0)];
+	else {
+		int	n = len - 9;
+
+		*ptr++ = wbub_charenc[0x30|((n>>5)&0x0e)|(inc?1:0)];
+		*ptr++ = wbub_charenc[n&0x3f];
+	}
+
+	return ptr;
+}
+
+/*
+ * writev
+ *
+ * The internal write function, through which all writes pass.
+ *
+ * Parameters:
+ *	a	is the address to write to
+ *	p	=1 to increment address, 0 otherwise
+ *	len	The number of values to write to the bus
+ *	buf	A memory pointer to the information to write
+ *
+ * As with the HEXBUS, up to m_wrwindow writes may be unacknowledged at any
+ * one time, and acknowledgements are collected between batches.  Each batch
+ * ends with a newline, so that the bus isn't held while we wait.
+ */
+void	WBUBUS::writev(const BUSW a, const int p, const int len,
+		const BUSW *buf) {
+	char	*ptr;
+	unsigned	nw = 0;
+
+	if (len <= 0)
+		return;
+	DBGPRINTF("WBU-WRITEV(%08x,%d,#%d,0x%08x ...)\n", a, p, len, buf[0]);
+
+	// Every word takes at most six characters, plus a newline per batch
+	// and up to eight characters for the address
+	bufalloc(6*m_wrwindow + 16);
+
+	ptr = encode_address(m_buf, a);
+	m_lastaddr = a; m_addr_set = true; m_inc = p;
+	m_nacks = 0;
+
+	try {
+	    while(nw < (unsigned)len) {
+		if (nw - m_nacks > (unsigned)m_wrwindow/2) {
+			waitacks(nw - m_wrwindow/2);
+			continue;
+		}
+
+		while((nw < (unsigned)len)&&(nw - m_nacks < (unsigned)m_wrwindow))
+			ptr = encode_write(ptr, buf[nw++], p);
+		*ptr++ = '\n';
+
+		m_dev->write(m_buf, ptr-m_buf);
+		DBGPRINTF("WBU-WRITEV: %d writes outstanding\n", nw - m_nacks);
+		ptr = m_buf;
+
+		readidle();
+	    }
+
+	    waitacks(len);
+	} catch(BUSERR b) {
+		BUSW	erraddr = a + ((p)?(m_nacks<<2):0);
+
+		DBGPRINTF("WBU-WRITEV::BUSERR writing %08x\n", erraddr);
+
+		drain();
+		m_bus_err = true;
+		m_addr_set = false;
+		throw BUSERR(erraddr);
+	}
+
+	m_lastaddr = a + ((p)?(len<<2):0);
+}
+
+/*
+ * waitacks
+ *
+ * Block until at least nacks write acknowledgements have been received.
+ * Will throw a BUSERR if a bus error is received along the way.
+ */
+void	WBUBUS::waitacks(unsigned nacks) {
+	while(m_nacks < nacks) {
+		m_dev->poll(WBUB_ACKTIMEOUT);
+		readidle();
+	}
+}
+
+/*
+ * drain
+ *
+ * Following a bus error, read and discard any responses still on their way
+ * until the interface goes quiet.  The FPGA drops the rest of any read or
+ * write that fails without a response, so we can't count what's left.
+ */
+void	WBUBUS::drain(void) {
+	DBGPRINTF("WBU-DRAIN\n");
+	while(m_dev->poll(WBUB_ACKTIMEOUT)) {
+		try {
+			readidle();
+		} catch(BUSERR b) {
+			// Already failed, keep going
+		}
+	}
+}
+
+/*
+ * writez
+ *
+ * Write a buffer of values to a single address.
+ */
+void	WBUBUS::writez(const BUSW a, const int len, const BUSW *buf) {
+	writev(a, 0, len, buf);
+}
+
+/*
+ * writei
+ *
+ * Write a buffer of values to a memory range, incrementing the address
+ * after every write.
+ */
+void	WBUBUS::writei(const BUSW a, const int len, const BUSW *buf) {
+	writev(a, 1, len, buf);
+}
+
+/*
+ * readio
+ *
+ * Read a single value from the bus.
+ */
+WBUBUS::BUSW	WBUBUS::readio(const WBUBUS::BUSW a) {
+	BUSW	v;
+
+	DBGPRINTF("WBU-READIO(0x%08x)\n", a);
+	try {
+		readv(a, 0, 1, &v);
+	} catch(BUSERR b) {
+		DBGPRINTF("WBU-READIO::BUSERR trying to read %08x\n", a);
+		throw BUSERR(a);
+	}
+
+	if (m_lastaddr != a) {
+		DBGPRINTF("LAST-ADDR MIS-MATCH: (RCVD) %08x != %08x (XPECTED)\n", m_lastaddr, a);
+		m_addr_set = false;
+
+		exit(EXIT_FAILURE);
+	}
+
+	return v;
+}
+
+/*
+ * encode_address
+ *
+ * Places a set address command into the buffer at ptr, returning a pointer
+ * to the character following, unless the bus is already set to the address
+ * we need.  The wbubus works in word addresses, and whether or not to
+ * increment is part of every read or write command rather than the address.
+ * We send whichever is shortest: the full address, the address compressed to
+ * fewer bits, or its difference from the last address.
+ */
+char	*WBUBUS::encode_address(char *ptr, const WBUBUS::BUSW a) {
+	unsigned	wa = a >> 2;
+	int		diff = (int)(wa - (m_lastaddr >> 2));
+	int		nabs, ndif;
+
+	if ((m_addr_set)&&(a == m_lastaddr)) {
+		DBGPRINTF("Address is already set to %08x\n", a);
+		return ptr;
+	}
+
+	// If we don't know where we are, we might not know where the FPGA is
+	// within any prior codeword either.  A newline starts it over.
+	if (!m_addr_set)
+		*ptr++ = '\n';
+
+	// How many six bit characters would each form take?
+	for(nabs=1; (nabs<=4)&&((wa >> (6*nabs)) != 0); nabs++)
+		;
+	for(ndif=1; ndif<=4; ndif++) {
+		int	lim = 1<<(6*ndif-1);
+
+		if ((diff >= -lim)&&(diff < lim))
+			break;
+	} if (!m_addr_set)
+		ndif = 5;
+
+	if ((nabs > 4)&&(ndif > 4)) {
+		*ptr++ = wbub_charenc[(wa>>30)&3];
+		for(int s=24; s>=0; s-=6)
+			*ptr++ = wbub_charenc[(wa>>s)&0x3f];
+	} else if (nabs <= ndif) {
+		*ptr++ = wbub_charenc[0x08|((nabs-1)<<1)];
+		for(int s=6*(nabs-1); s>=0; s-=6)
+			*ptr++ = wbub_charenc[(wa>>s)&0x3f];
+	} else {
+		*ptr++ = wbub_charenc[0x08|((ndif-1)<<1)|1];
+		for(int s=6*(ndif-1); s>=0; s-=6)
+			*ptr++ = wbub_charenc[(diff>>s)&0x3f];
+	}
+
+	return ptr;
+}
+
+/*
+ * readv
+ *
+ * This is the main worker routine for read calls.  readio, readz, readi, all
+ * end up here.
+ *
+ * Parameters:
+ *	a	The address to start reading from
+ *	inc	'1' if we want to increment the address following each read,
+ *		'0' otherwise
+ *	len	The number of words to read
+ *	buf	A memory buffer storage location to place the results into
+ *
+ * As with the HEXBUS, up to m_rdwindow reads are kept in flight at any given
+ * time, topping the window off once it has drained by half.  Here, though,
+ * one or two characters request up to WBUB_MAXRDLEN reads.
+ */
+void	WBUBUS::readv(const WBUBUS::BUSW a, const int inc, const int len, WBUBUS::BUSW *buf) {
+	int	nread = 0, nsent = 0;
+	char	*ptr;
+
+	if (len <= 0)
+		return;
+	DBGPRINTF("WBU-READV(%08x,%d,#%4d)\n", a, inc, len);
+
+	bufalloc(2*(m_rdwindow/WBUB_MAXRDLEN) + 20);
+	ptr = encode_address(m_buf, a);
+	m_lastaddr = a; m_addr_set = true; m_inc = inc;
+	try {
+	    while(nread < len) {
+		if ((nsent < len)&&((nsent - nread <= m_rdwindow/2)
+					||(nsent == nread))) {
+			while((nsent < len)&&(nsent - nread < m_rdwindow)) {
+				int	n = len - nsent;
+
+				if (n > m_rdwindow - (nsent - nread))
+					n = m_rdwindow - (nsent - nread);
+				if (n > WBUB_MAXRDLEN)
+					n = WBUB_MAXRDLEN;
+				ptr = encode_read(ptr, n, inc);
+				nsent += n;
+			}
+
+			m_dev->write(m_buf, (ptr-m_buf));
+			DBGPRINTF("WBU-READV: %d requests outstanding\n",
+				nsent - nread);
+			ptr = m_buf;
+		}
+
+		buf[nread++] = readword();
+	    }
+	} catch(BUSERR b) {
+		DBGPRINTF("WBU-READV::BUSERR trying to read %08x\n", a+((inc)?(nread<<2):0));
+		m_addr_set = false;
+		if (b.addr != 0)
+			drain();
+		throw BUSERR(a+((inc)?(nread<<2):0));
+	}
+
+	if ((unsigned)m_lastaddr != (a+((inc)?(len<<2):0))) {
+		printf("WBUBUS::READV(a=%08x,inc=%d,len=%4x,x) ERR: (Last) %08x != %08x + %08x (Expected)\n", a, inc, len<<2, m_lastaddr, a, (inc)?(len<<2):0);
+		fflush(stdout);
+		exit(EXIT_FAILURE);
+	}
+
+	DBGPRINTF("WBU-READV::COMPLETE, [%08x] -> %08x%s\n", a, buf[0],
+		(len>1)?", ...":"");
+}
+
+/*
+ * readi
+ *
+ * Read a series of values from bus addresses starting at address a,
+ * incrementing the address to read from subsequent addresses along the way.
+ */
+void	WBUBUS::readi(const WBUBUS::BUSW a, const int len, WBUBUS::BUSW *buf) {
+	readv(a, 1, len, buf);
+}
+
+/*
+ * readz
+ *
+ * Read a series of values from the bus, with all the values coming from the
+ * same address: a.
+ */
+void	WBUBUS::readz(const WBUBUS::BUSW a, const int len, WBUBUS::BUSW *buf) {
+	readv(a, 0, len, buf);
+}
+
+/*
+ * runv
+ *
+ * Runs a list of transactions, keeping as many of their reads and writes in
+ * flight at once as our windows allow, just as HEXBUS::runv() does.  Each
+ * transaction starts with an absolute address.
+ *
+ * Unlike the hexbus, the wbubus drops whatever remains of a command once it
+ * fails, so we can't tell which of the responses that follow an error
+ * belong to which transaction.  Instead, we drain the link and fail every
+ * transaction we had started (some of these may have completed anyway),
+ * then carry on with the rest.
+ */
+void	WBUBUS::runv(const int n, BUSTRANS *t) {
+	int	ti = 0, wi = 0;	// The transaction and word to issue next
+	int	tc = 0, wc = 0;	// The transaction and word to collect next
+	int	nrd = 0, nwr = 0;	// The reads and writes outstanding
+	const int	full = m_rdwindow * m_wrwindow;
+	unsigned	nacks = 0;
+	char	*ptr;
+
+	DBGPRINTF("WBU-RUNV(#%d)\n", n);
+	for(int k=0; k<n; k++)
+		t[k].m_err = false;
+
+	// A write takes at most six characters, an address seven, and a read
+	// two for every WBUB_MAXRDLEN words.  Allow for one address per word
+	// outstanding.
+	bufalloc(14*(m_rdwindow + m_wrwindow) + 16);
+	m_nacks = 0;
+	while(tc < n) {
+		if ((ti < n)&&((nrd+nwr == 0)
+			||(2*(nrd*m_wrwindow + nwr*m_rdwindow) <= full))) {
+			ptr = m_buf;
+			while(ti < n) {
+				BUSTRANS	*p = &t[ti];
+				int	room, nw = p->m_len - wi;
+
+				if (p->m_len <= 0) {
+					ti++;
+					continue;
+				}
+
+				room = full - nrd*m_wrwindow - nwr*m_rdwindow;
+				room /= (p->m_write) ? m_rdwindow : m_wrwindow;
+				if (nw > room)
+					nw = room;
+				if (nw <= 0)
+					break;
+
+				if (wi == 0) {
+					m_addr_set = false;
+					ptr = encode_address(ptr, p->m_addr);
+				}
+
+				if (p->m_write) {
+					for(int k=0; k<nw; k++)
+						ptr = encode_write(ptr,
+							p->m_buf[wi+k],
+							p->m_inc);
+				} else for(int k=0; k<nw; ) {
+					int	nb = nw - k;
+
+					if (nb > WBUB_MAXRDLEN)
+						nb = WBUB_MAXRDLEN;
+					ptr = encode_read(ptr, nb, p->m_inc);
+					k += nb;
+				}
+
+				if (p->m_write)
+					nwr += nw;
+				else
+					nrd += nw;
+				wi += nw;
+				if (wi >= p->m_len) {
+					ti++;
+					wi = 0;
+				}
+			}
+
+			*ptr++ = '\n';
+			m_dev->write(m_buf, ptr-m_buf);
+			DBGPRINTF("WBU-RUNV: %d reads, %d writes outstanding\n",
+				nrd, nwr);
+		}
+
+		// Collect the response to the next word outstanding
+		BUSTRANS	*p = &t[tc];
+		if (wc >= p->m_len) {
+			tc++;
+			wc = 0;
+			continue;
+		}
+
+		try {
+			if (p->m_write) {
+				while(m_nacks < nacks+1)
+					readword(true);
+				nacks++;
+			} else
+				p->m_buf[wc] = readword();
+		} catch(BUSERR b) {
+			BUSW	erraddr = p->m_addr + ((p->m_inc)?(wc<<2):0);
+
+			DBGPRINTF("WBU-RUNV::BUSERR at %08x\n", erraddr);
+			p->m_err = true;
+			p->m_erraddr = erraddr;
+
+			if (b.addr == 0) {
+				for(int k=tc+1; k<n; k++) {
+					t[k].m_err = true;
+					t[k].m_erraddr = t[k].m_addr;
+				} break;
+			}
+
+			drain();
+
+			// Everything we've issued since is now suspect
+			for(int k=tc+1; k<n; k++) {
+				if ((k > ti)||((k == ti)&&(wi == 0)))
+					break;
+				t[k].m_err = true;
+				t[k].m_erraddr = t[k].m_addr;
+			}
+
+			// Start over from the first transaction not yet
+			// (fully) issued
+			if (wi != 0) {
+				ti++;
+				wi = 0;
+			}
+			tc = ti; wc = 0;
+			nrd = nwr = 0;
+			nacks = m_nacks = 0;
+			continue;
+		}
+
+		if (p->m_write)
+			nwr--;
+		else
+			nrd--;
+		wc++;
+	}
+
+	m_addr_set = false;
+}
+
+/*
+ * readrsp
+ *
+ * Decode the incoming character stream, returning the first six bits of the
+ * next complete response.  The bits of any characters following the first
+ * are left in m_rspword.  If block is false, we return -1 rather than wait
+ * on a response that hasn't (completely) arrived yet.  Any partial response
+ * is kept for the next call.
+ */
+int	WBUBUS::readrsp(const bool block) {
+	char	ch;
+	int	v;
+
+	while((block)||(m_dev->available())) {
+		if (lclreadcode(&ch, 1) < 1)
+			continue;
+
+		v = wbub_chardec(ch);
+		if (v < 0) {
+			// A newline.  These only ever come between responses
+			m_rsplen = 0;
+			continue;
+		}
+
+		if (m_rsplen == 0) {
+			// The first character of a new response.  How many
+			// more are there to come?  (See wbudeword.v)
+			m_rsp = v;
+			m_rspword = 0;
+			if ((v & 0x38) == 0)
+				m_rsplen = 0;
+			else if ((v & 0x3c) == 0x08)
+				m_rsplen = 5;
+			else if ((v & 0x3c) == 0x0c)
+				m_rsplen = 1 + (v & 3);
+			else if ((v & 0x30) == 0x10)
+				m_rsplen = 1;
+			else if ((v & 0x30) == 0x20)
+				m_rsplen = 0;
+			else
+				m_rsplen = 5;
+
+			if (m_rsplen == 0)
+				return m_rsp;
+			continue;
+		}
+
+		m_rspword = (m_rspword << 6) | v;
+		if (--m_rsplen == 0)
+			return m_rsp;
+	}
+
+	return -1;
+}
+
+/*
+ * process
+ *
+ * Update our state given a response returned from readrsp().  Returns true
+ * if the response was read data, leaving the value read in m_rspword, and
+ * throws a BUSERR on any bus error.
+ */
+bool	WBUBUS::process(int rsp) {
+	unsigned	back;
+
+	if ((rsp & 0x38) == 0) {
+		switch(rsp) {
+		case WBUB_ACK:
+			if (m_inc)
+				m_lastaddr += 4;
+			m_nacks++;
+			return false;
+		case WBUB_RESET:
+			DBGPRINTF("BUS RESET\n");
+			m_addr_set = false;
+			m_bus_err = false;
+			return false;
+		case WBUB_INT:
+			m_interrupt_flag = true;
+			return false;
+		case WBUB_ERR:
+			DBGPRINTF("Bus error(%08x)\n", m_lastaddr);
+			m_bus_err = true;
+			throw BUSERR(m_lastaddr);
+		case WBUB_IDLE:
+		case WBUB_BUSBUSY:
+			return false;
+		default: // A repeat of the last value read
+			back = 1;
+			break;
+		}
+	} else if ((rsp & 0x30) == 0) {
+		// A new address.  The FPGA starts its table of values read
+		// over from here.
+		if (rsp & 4)
+			m_lastaddr = m_rspword << 2;
+		else
+			m_lastaddr = (((rsp&3)<<30)|m_rspword) << 2;
+		m_addr_set = true;
+		m_rdtbl_addr = 0;
+		DBGPRINTF("RCVD ADDR: 0x%08x\n", m_lastaddr);
+		return false;
+	} else if ((rsp & 0x30) == 0x10)
+		back = ((((rsp>>1)&7)<<6)|m_rspword) + 10;
+	else if ((rsp & 0x30) == 0x20)
+		back = ((rsp>>1)&7) + 2;
+	else {
+		// A full value, which now goes into our table
+		m_rspword |= ((rsp>>1)&3)<<30;
+		m_rdtbl[(m_rdtbl_addr++)&(WBUB_RDTBLSZ-1)] = m_rspword;
+		back = 0;
+	}
+
+	if (back)
+		m_rspword = m_rdtbl[(m_rdtbl_addr-back)&(WBUB_RDTBLSZ-1)];
+
+	m_inc = (rsp & 1);
+	if (m_inc)
+		m_lastaddr += 4;
+	return true;
+}
+
+/*
+ * readword()
+ *
+ * Once the read command has been issued, readword() is called to read each
+ * word's response from the bus.  Any other responses, such as interrupts
+ * or bus errors, are processed along the way.  If ack is set, we also return
+ * after any write acknowledgement.
+ */
+WBUBUS::BUSW	WBUBUS::readword(const bool ack) {
+	int		rsp;
+	unsigned	abort_countdown = 3;
+
+	while(1) {
+		rsp = readrsp(true);
+		if ((rsp == WBUB_IDLE)||(rsp == WBUB_BUSBUSY)) {
+			abort_countdown--;
+			if (0 == abort_countdown) {
+				DBGPRINTF("Bus error(0x%08x,ABORT)\n",
+					m_lastaddr);
+				throw BUSERR(0);
+			}
+		} else if (process(rsp))
+			return m_rspword;
+		else if ((ack)&&(rsp == WBUB_ACK))
+			return 0;
+	}
+}
+
+/*
+ * readidle()
+ *
+ * Process any responses that have already arrived, without waiting on any
+ * more.  Read data isn't expected here, and so it is ignored.
+ */
+void	WBUBUS::readidle(void) {
+	int	rsp;
+
+	while((rsp = readrsp(false)) >= 0)
+		process(rsp);
+}
+
+/*
+ * usleep()
+ *
+ * Called to implement some form of time-limited wait on a response from the
+ * bus.
+ */
+void	WBUBUS::usleep(unsigned ms) {
+	if (m_dev->poll(ms)) {
+		try {
+			readidle();
+		} catch(BUSERR b) {
+			// m_bus_err is already set
+		}
+	}
+}
+
+/*
+ * wait()
+ *
+ * Wait for an interrupt condition.
+ */
+void	WBUBUS::wait(void) {
+	if (m_interrupt_flag)
+		DBGPRINTF("INTERRUPTED PRIOR TO WAIT()\n");
+	do {
+		usleep(200);
+	} while(!m_interrupt_flag);
+}
@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	wbubus.h
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	This is the C++ program on the command side that will interact
+//		with the compressing wbubus on an FPGA (rtl/catzip/wbubus), to
+//	command the WISHBONE on that same FPGA to ... whatever we wish to
+//	command it to do.  It is a drop in replacement for the HEXBUS.  Words
+//	are sent in printable six-bit characters, and both addresses and
+//	recently seen values are compressed in each direction.
+//
+//	This code does not run on an FPGA, is not a test bench, neither
+//	is it a simulator.  It is a portion of a command program
+//	for commanding an FPGA.
+//
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+//
+#ifndef	WBUBUS_H
+#define	WBUBUS_H
+
+#include "llcomms.h"
+#include "devbus.h"
+
+// The maximum number of words we can read with a single command
+#define	WBUB_MAXRDLEN	520
+
+// The number of reads we'll keep in flight at once.  The responses must all
+// fit within the output FIFO (wbuoutput) within the RTL.
+#ifndef	WBUB_RDWINDOW
+#define	WBUB_RDWINDOW	512
+#endif
+
+// The number of writes we'll allow to be unacknowledged at once.  Every
+// write takes a slot in the input FIFO, so this must be less than its depth.
+#ifndef	WBUB_WRWINDOW
+#define	WBUB_WRWINDOW	32
+#endif
+
+// How long (in ms) to wait on the device for any write acknowledgements
+#define	WBUB_ACKTIMEOUT	20
+
+// The sizes of the compression tables within the RTL.  Writes are compressed
+// by wbudecompress, reads by wbucompress.
+#define	WBUB_WRTBLSZ	256
+#define	WBUB_RDTBLSZ	1024
+
+class	WBUBUS : public DEVBUS {
+public:
+	unsigned long	m_total_nread;
+private:
+	LLCOMMSI	*m_dev;
+
+	bool	m_interrupt_flag, m_addr_set, m_bus_err;
+	unsigned int	m_lastaddr, m_nacks;
+	bool		m_inc;
+
+	// Response decoding state.  m_rsp is the first character of the
+	// response being decoded, m_rsplen the number of characters of it
+	// still to come
+	int		m_rsp, m_rsplen;
+	unsigned	m_rspword;
+
+	// Our copies of the compression tables.  m_wrtbl holds the last
+	// WBUB_WRTBLSZ values we've written uncompressed, m_rdtbl the values
+	// we've read uncompressed since the last address was returned.
+	BUSW		m_wrtbl[WBUB_WRTBLSZ], m_rdtbl[WBUB_RDTBLSZ];
+	unsigned	m_wrtbl_addr, m_wrtbl_valid, m_rdtbl_addr;
+
+	int	m_buflen, m_rdwindow, m_wrwindow;
+	char	*m_buf;
+
+	void	init(void) {
+		m_total_nread = 0;
+		m_interrupt_flag = false;
+		m_buflen = 0; m_buf = NULL;
+		m_addr_set = false;
+		bufalloc(64);
+		m_bus_err    = false;
+		m_nacks = 0;
+		m_rsp = -1; m_rsplen = 0; m_rspword = 0;
+		m_wrtbl_addr = 0; m_wrtbl_valid = 0; m_rdtbl_addr = 0;
+		m_rdwindow = WBUB_RDWINDOW;
+		m_wrwindow = WBUB_WRWINDOW;
+	}
+
+	void	bufalloc(int len);
+	BUSW	readword(const bool ack = false); // Reads a word from the bus
+	void	readv(const BUSW a, const int inc, const int len, BUSW *buf);
+	void	writev(const BUSW a, const int p, const int len, const BUSW *buf);
+	void	readidle(void);
+	void	drain(void);
+	void	waitacks(unsigned nacks);
+
+	int	lclreadcode(char *buf, int len);
+	int	readrsp(const bool block);
+	bool	process(int rsp);
+	char	*encode_write(char *ptr, const BUSW v, const int inc);
+	char	*encode_read(char *ptr, const int len, const int inc);
+	char	*encode_address(char *ptr, const BUSW a);
+public:
+	WBUBUS(LLCOMMSI *comms) : m_dev(comms) { init(); }
+	virtual	~WBUBUS(void) {
+		m_dev->close();
+		if (m_buf)
+			delete[] m_buf;
+		m_buf = NULL;
+		delete	m_dev;
+	}
+
+	void	kill(void) { m_dev->close(); }
+	void	close(void) {	m_dev->close(); }
+	void	writeio(const BUSW a, const BUSW v);
+	BUSW	readio(const BUSW a);
+	void	readi( const BUSW a, const int len, BUSW *buf);
+	void	readz( const BUSW a, const int len, BUSW *buf);
+	void	writei(const BUSW a, const int len, const BUSW *buf);
+	void	writez(const BUSW a, const int len, const BUSW *buf);
+	bool	poll(void) { return m_interrupt_flag; };
+	void	usleep(unsigned msec); // Sleep until interrupt
+	void	wait(void); // Sleep until interrupt
+	bool	bus_err(void) const { return m_bus_err; };
+	void	reset_err(void) { m_bus_err = false; }
+	void	clear(void) { m_interrupt_flag = false; }
+
+	// Run a list of transactions, several at a time
+	void	runv(const int n, BUSTRANS *t);
+
+	// Set the maximum number of reads that may be outstanding at any
+	// one time
+	void	readwindow(int w) { m_rdwindow = (w < 1) ? 1 : w; }
+	int	readwindow(void) const { return m_rdwindow; }
+
+	// Set the maximum number of writes that may be unacknowledged at any
+	// one time.  This is bounded by the depth of the input FIFO within
+	// the RTL.
+	void	writewindow(int w) { m_wrwindow = (w < 1) ? 1 : w; }
+	int	writewindow(void) const { return m_wrwindow; }
+};
+
+#endif
@@ -0,0 +1,227 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	wbwatch.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Watches a set of registers, reading them as fast as the link
+//		to the FPGA allows, and streaming timestamped samples of
+//	them to a file.  All of the reads making up one sample are issued at
+//	once, through a BUSQUEUE, so that a sample costs little more than a
+//	single round trip no matter how many registers it contains.  When done,
+//	the rate of samples actually achieved is reported.
+//
+//	Samples are written either as CSV, with a header naming each register,
+//	or as binary records.  Each binary record is a 64-bit timestamp
+//	followed by one 32-bit word per register, all in the byte order of the
+//	host.  Timestamps are in microseconds since the first sample.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "port.h"
+#include "regdefs.h"
+#include "hexbus.h"
+#include "busqueue.h"
+
+// The most registers we'll watch at once
+#define	MAXWATCH	64
+
+FPGA	*m_fpga;
+bool	gbl_done = false;
+
+void	closeup(int v) {
+	gbl_done = true;
+}
+
+/*
+ * now_us
+ *
+ * Returns the (monotonic) time in microseconds
+ */
+uint64_t	now_us(void) {
+	struct	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+
+void	usage(void) {
+	printf("USAGE: wbwatch [-b] [-c count] [-t secs] [-i usecs] [-o file] reg ...\n"
+"\n"
+"\tReads the registers given, by name or address, as fast as the link\n"
+"\tallows, writing each sample to a file, and reporting the sample rate\n"
+"\tachieved when done.  Stops on a control-C, if not before.\n"
+"\n"
+"\t-b\tWrite binary samples, rather than CSV\n"
+"\t-c count\tStop after count samples\n"
+"\t-t secs\tStop after secs seconds\n"
+"\t-i usecs\tWait usecs microseconds between samples\n"
+"\t-o file\tWrite the samples to file, rather than to stdout\n"
+"\t-n host\tThe network host to connect to [%s]\n"
+"\t-p port\tThe network port to connect to [%d]\n",
+		FPGAHOST, FPGAPORT);
+}
+
+int main(int argc, char **argv) {
+	const char	*host = FPGAHOST, *fname = NULL;
+	int		port = FPGAPORT, opt, nregs = 0;
+	bool		binary = false;
+	unsigned long	count = 0, nsamples = 0, nerrs = 0;
+	double		maxtime = 0.0;
+	unsigned	interval = 0;
+	unsigned	addr[MAXWATCH];
+	const char	*name[MAXWATCH];
+	FILE		*fp = stdout;
+
+	while((opt = getopt(argc, argv, "bc:hi:n:o:p:t:")) != -1) {
+		switch(opt) {
+		case 'b': binary = true; break;
+		case 'c': count = strtoul(optarg, NULL, 0); break;
+		case 'i': interval = strtoul(optarg, NULL, 0); break;
+		case 'n': host = optarg; break;
+		case 'o': fname = optarg; break;
+		case 'p': port = strtoul(optarg, NULL, 0); break;
+		case 't': maxtime = atof(optarg); break;
+		case 'h': usage(); exit(EXIT_SUCCESS);
+		default:
+			usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	for(int argn=optind; argn<argc; argn++) {
+		if (nregs >= MAXWATCH) {
+			fprintf(stderr, "ERR: Too many registers, at most %d may be watched\n", MAXWATCH);
+			exit(EXIT_FAILURE);
+		}
+
+		if (isdigit(argv[argn][0])) {
+			addr[nregs] = strtoul(argv[argn], NULL, 0);
+			name[nregs] = addrname(addr[nregs]);
+			if (!name[nregs])
+				name[nregs] = argv[argn];
+		} else {
+			addr[nregs] = addrdecode(argv[argn]);
+			name[nregs] = argv[argn];
+		} nregs++;
+	}
+
+	if (nregs == 0) {
+		fprintf(stderr, "ERR: No registers given to watch\n");
+		usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if (fname) {
+		fp = fopen(fname, (binary) ? "wb" : "w");
+		if (NULL == fp) {
+			fprintf(stderr, "ERR: Cannot open %s\n", fname);
+			perror("O/S Err:");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	m_fpga = new FPGA(new NETCOMMS(host, port));
+	signal(SIGINT, closeup);
+
+	BUSQUEUE		q(m_fpga, nregs);
+	BUSQUEUE::HANDLE	h[MAXWATCH];
+	uint32_t		v[MAXWATCH];
+	uint64_t		start, t;
+
+	if (!binary) {
+		fprintf(fp, "time_us");
+		for(int k=0; k<nregs; k++)
+			fprintf(fp, ",%s", name[k]);
+		fprintf(fp, "\n");
+	}
+
+	start = now_us();
+	while(!gbl_done) {
+		// Read the whole sample in one go
+		for(int k=0; k<nregs; k++)
+			h[k] = q.readio(addr[k]);
+		t = now_us() - start;
+		q.flush();
+
+		for(int k=0; k<nregs; k++) {
+			if (q.err(h[k])) {
+				// Mark any register we couldn't read as all
+				// ones
+				v[k] = 0xffffffff;
+				nerrs++;
+			} else
+				v[k] = q.value(h[k]);
+		}
+
+		if (binary) {
+			fwrite(&t, sizeof(t), 1, fp);
+			fwrite(v, sizeof(v[0]), nregs, fp);
+		} else {
+			fprintf(fp, "%lu", (unsigned long)t);
+			for(int k=0; k<nregs; k++)
+				fprintf(fp, ",0x%08x", v[k]);
+			fprintf(fp, "\n");
+		}
+
+		nsamples++;
+		if ((count)&&(nsamples >= count))
+			break;
+		if ((maxtime > 0.0)&&(t >= maxtime * 1e6))
+			break;
+		if (interval)
+			usleep(interval);
+	}
+
+	t = now_us() - start;
+	if (fp != stdout)
+		fclose(fp);
+	else
+		fflush(fp);
+
+	fprintf(stderr, "%lu samples of %d registers in %.3f s: %.1f samples/s",
+		nsamples, nregs, t / 1e6,
+		(t > 0) ? nsamples * 1e6 / t : 0.0);
+	if (nerrs)
+		fprintf(stderr, ", %lu bus errors", nerrs);
+	fprintf(stderr, "\n");
+
+	delete	m_fpga;
+	return (nerrs) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -249,3 +249,112 @@ assert(n != 0);
 	close(fd);
 }
 
+static	int	symcmp(const void *va, const void *vb) {
+	const ELFSYMBOL	*a = (const ELFSYMBOL *)va,
+			*b = (const ELFSYMBOL *)vb;
+
+	if (a->m_addr != b->m_addr)
+		return (a->m_addr < b->m_addr) ? -1 : 1;
+	// Of two names for the same address, put the longer function first
+	if (a->m_len != b->m_len)
+		return (a->m_len > b->m_len) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * elfsymbols
+ *
+ * Read the functions out of an ELF file's symbol table.  Along with those
+ * the compiler marks as functions, this picks up any global labels in code
+ * sections that were never marked at all, such as those in hand-written
+ * assembly.
+ */
+int	elfsymbols(const char *fname, ELFSYMBOL *&symbols) {
+	Elf	*e;
+	Elf_Scn	*scn = NULL;
+	GElf_Shdr	shdr;
+	int	fd, nsyms = 0, maxsyms = 0;
+
+	symbols = NULL;
+
+	if (elf_version(EV_CURRENT) == EV_NONE) {
+		fprintf(stderr, "ELF library initialization err, %s\n", elf_errmsg(-1));
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	} if ((fd = open(fname, O_RDONLY, 0)) < 0) {
+		fprintf(stderr, "Could not open %s\n", fname);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	} if ((e = elf_begin(fd, ELF_C_READ, NULL))==NULL) {
+		fprintf(stderr, "Could not run elf_begin, %s\n", elf_errmsg(-1));
+		exit(EXIT_FAILURE);
+	}
+
+	while((scn = elf_nextscn(e, scn)) != NULL) {
+		Elf_Data	*data;
+		int		n;
+
+		if (gelf_getshdr(scn, &shdr) != &shdr) {
+			fprintf(stderr, "getshdr() failed: %s\n", elf_errmsg(-1));
+			exit(EXIT_FAILURE);
+		}
+
+		if ((shdr.sh_type != SHT_SYMTAB)||(shdr.sh_entsize == 0))
+			continue;
+
+		data = elf_getdata(scn, NULL);
+		n = shdr.sh_size / shdr.sh_entsize;
+		for(int k=0; k<n; k++) {
+			GElf_Sym	sym;
+			GElf_Shdr	symshdr;
+			Elf_Scn		*symscn;
+			const char	*name;
+			int		typ;
+
+			if (gelf_getsym(data, k, &sym) != &sym)
+				continue;
+
+			typ = GELF_ST_TYPE(sym.st_info);
+			if (typ == STT_NOTYPE) {
+				// Only global labels, in code, count
+				if (GELF_ST_BIND(sym.st_info) != STB_GLOBAL)
+					continue;
+				if ((sym.st_shndx == SHN_UNDEF)
+						||(sym.st_shndx >= SHN_LORESERVE))
+					continue;
+				symscn = elf_getscn(e, sym.st_shndx);
+				if ((!symscn)||(gelf_getshdr(symscn, &symshdr)
+						!= &symshdr)
+						||(!(symshdr.sh_flags & SHF_EXECINSTR)))
+					continue;
+			} else if (typ != STT_FUNC)
+				continue;
+
+			name = elf_strptr(e, shdr.sh_link, sym.st_name);
+			if ((!name)||(!name[0]))
+				continue;
+
+			if (nsyms >= maxsyms) {
+				maxsyms = (maxsyms) ? maxsyms * 2 : 256;
+				symbols = (ELFSYMBOL *)realloc(symbols,
+						maxsyms * sizeof(ELFSYMBOL));
+				if (!symbols) {
+					fprintf(stderr, "No memory for symbols\n");
+					exit(EXIT_FAILURE);
+				}
+			}
+
+			symbols[nsyms].m_addr = sym.st_value;
+			symbols[nsyms].m_len  = sym.st_size;
+			symbols[nsyms].m_name = strdup(name);
+			nsyms++;
+		}
+	}
+
+	elf_end(e);
+	close(fd);
+
+	if (nsyms > 0)
+		qsort(symbols, nsyms, sizeof(ELFSYMBOL), symcmp);
+	return nsyms;
+}
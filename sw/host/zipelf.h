@@ -49,7 +49,17 @@ public:
 	char		m_data[4];
 };
 
+// A function, found in an ELF file's symbol table
+class	ELFSYMBOL {
+public:
+	uint32_t	m_addr, m_len;
+	char		*m_name;
+};
+
 bool	iself(const char *fname);
 void	elfread(const char *fname, uint32_t &entry, ELFSECTION **&sections);
+// Read the functions from an ELF file's symbol table, sorted by address,
+// returning how many there were
+int	elfsymbols(const char *fname, ELFSYMBOL *&symbols);
 
 #endif
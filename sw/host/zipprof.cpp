@@ -0,0 +1,351 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	zipprof.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	Makes sense of a ZipCPU profile, as written by the simulator
+//		(main_tb -f), by matching it against the ELF file that was
+//	run.  It reports where the clock cycles went: by function, and
+//	optionally by source line (using zip-addr2line) and by call graph.
+//
+//	Every clock tick is charged to the instruction the CPU was waiting to
+//	retire, either as the tick it retired on, or as a stall.  The call graph
+//	charges each function with every cycle from its call until its return,
+//	including those spent in the functions it calls.  (Recursive calls are
+//	charged at every level.)
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "zipelf.h"
+#include "profdata.h"
+
+// The tool used to find the source line of each address
+#define	ADDR2LINE	"zip-addr2line"
+
+typedef	struct	{
+	uint64_t	m_retired, m_stalls;
+} STATS;
+
+typedef	struct	{
+	uint64_t	m_calls, m_cycles;
+	std::map<int, STATS>	m_callers; // calls and cycles, per caller
+} CALLEE;
+
+PROFHDR		gbl_hdr;
+PROFPC		*gbl_pcs;
+PROFARC		*gbl_arcs;
+ELFSYMBOL	*gbl_syms;
+int		gbl_nsyms;
+
+void	usage(void) {
+	fprintf(stderr, "USAGE: zipprof [-hgl] [-n <count>] <zipcpu-elf-file> [pfile.bin]\n"
+"\n"
+"\tReports where the ZipCPU spent its clock cycles, given the profile\n"
+"\twritten by main_tb -f, or by zipsample (pfile.bin by default)\n"
+"\n"
+"\t-g\tAlso report the call graph\n"
+"\t-h\tShow this usage statement\n"
+"\t-l\tAlso report cycles by source line, using " ADDR2LINE "\n"
+"\t-n <count>\n"
+"\t\tOnly report the <count> most expensive of each\n");
+}
+
+void	readprof(const char *fname) {
+	FILE	*fp;
+
+	if (NULL == (fp = fopen(fname, "rb"))) {
+		fprintf(stderr, "ERR: Could not open %s\n", fname);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	if ((fread(&gbl_hdr, sizeof(gbl_hdr), 1, fp) != 1)
+			||(gbl_hdr.m_magic != PROF_MAGIC)
+			||(gbl_hdr.m_version != PROF_VERSION)) {
+		fprintf(stderr, "ERR: %s is not a ZipCPU profile\n", fname);
+		exit(EXIT_FAILURE);
+	}
+
+	gbl_pcs  = new PROFPC[gbl_hdr.m_npcs];
+	gbl_arcs = new PROFARC[gbl_hdr.m_narcs];
+	if ((fread(gbl_pcs, sizeof(PROFPC), gbl_hdr.m_npcs, fp)
+				!= gbl_hdr.m_npcs)
+			||(fread(gbl_arcs, sizeof(PROFARC), gbl_hdr.m_narcs, fp)
+				!= gbl_hdr.m_narcs)) {
+		fprintf(stderr, "ERR: %s is truncated\n", fname);
+		exit(EXIT_FAILURE);
+	}
+
+	fclose(fp);
+}
+
+/*
+ * function
+ *
+ * Return the index of the function containing pc, or gbl_nsyms if there's
+ * none.  Functions of unknown length are assumed to run to the next.
+ */
+int	function(uint32_t pc) {
+	int	lo = 0, hi = gbl_nsyms;
+
+	// Find the first function starting after pc
+	while(lo < hi) {
+		int	mid = (lo + hi) / 2;
+
+		if (gbl_syms[mid].m_addr <= pc)
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return gbl_nsyms;
+	lo--;
+	// Back up to the first (longest) name for this address
+	while((lo > 0)&&(gbl_syms[lo-1].m_addr == gbl_syms[lo].m_addr))
+		lo--;
+	if ((gbl_syms[lo].m_len != 0)
+			&&(pc >= gbl_syms[lo].m_addr + gbl_syms[lo].m_len))
+		return gbl_nsyms;
+	return lo;
+}
+
+const char *fnname(int fn) {
+	return (fn < gbl_nsyms) ? gbl_syms[fn].m_name : "??";
+}
+
+double	percent(uint64_t cycles) {
+	return (gbl_hdr.m_ticks) ? 100.0 * cycles / gbl_hdr.m_ticks : 0.0;
+}
+
+void	printstats(const STATS &s, const char *name) {
+	uint64_t	cycles = s.m_retired + s.m_stalls;
+
+	if (gbl_hdr.m_flags & PROF_SAMPLED) {
+		// Samples say nothing about stalls, so there's no CPI either
+		printf("%6.2f %12lu  %s\n", percent(cycles),
+			(unsigned long)cycles, name);
+		return;
+	}
+
+	printf("%6.2f %12lu %12lu %12lu %6.2f  %s\n", percent(cycles),
+		(unsigned long)cycles, (unsigned long)s.m_retired,
+		(unsigned long)s.m_stalls,
+		(s.m_retired) ? (double)cycles / s.m_retired : 0.0, name);
+}
+
+static	bool	costlier(const std::pair<std::string, STATS> &a,
+			const std::pair<std::string, STATS> &b) {
+	return a.second.m_retired + a.second.m_stalls
+		> b.second.m_retired + b.second.m_stalls;
+}
+
+/*
+ * report
+ *
+ * Print the given costs, most expensive first
+ */
+void	report(const char *title, std::map<std::string, STATS> &costs,
+		int count) {
+	std::vector<std::pair<std::string, STATS> >	v(costs.begin(),
+								costs.end());
+
+	std::sort(v.begin(), v.end(), costlier);
+	printf("\n%s by %s\n\n", (gbl_hdr.m_flags & PROF_SAMPLED)
+		? "Samples" : "Cycles", title);
+	if (gbl_hdr.m_flags & PROF_SAMPLED)
+		printf("%6s %12s  %s\n", "%Time", "Samples", "Name");
+	else
+		printf("%6s %12s %12s %12s %6s  %s\n", "%Time", "Cycles",
+			"Retired", "Stalls", "CPI", "Name");
+	for(unsigned k=0; k<v.size() && (count <= 0 || (int)k < count); k++)
+		printstats(v[k].second, v[k].first.c_str());
+}
+
+void	byfunction(int count) {
+	std::map<std::string, STATS>	costs;
+
+	for(unsigned k=0; k<gbl_hdr.m_npcs; k++) {
+		STATS	&s = costs[fnname(function(gbl_pcs[k].m_pc))];
+
+		s.m_retired += gbl_pcs[k].m_retired;
+		s.m_stalls  += gbl_pcs[k].m_stalls;
+	}
+
+	report("function", costs, count);
+}
+
+/*
+ * byline
+ *
+ * Ask ADDR2LINE for the source line of every address in the profile, and
+ * charge each line with the cycles spent on its instructions
+ */
+void	byline(const char *elfname, int count) {
+	std::map<std::string, STATS>	costs;
+	char	tmpname[] = "/tmp/zipprofXXXXXX", cmd[512], line[512];
+	FILE	*fp;
+	int	fd;
+
+	if ((fd = mkstemp(tmpname)) < 0) {
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	fp = fdopen(fd, "w");
+	for(unsigned k=0; k<gbl_hdr.m_npcs; k++)
+		fprintf(fp, "0x%08x\n", gbl_pcs[k].m_pc);
+	fclose(fp);
+
+	snprintf(cmd, sizeof(cmd), ADDR2LINE " -e %s < %s", elfname, tmpname);
+	if (NULL == (fp = popen(cmd, "r"))) {
+		fprintf(stderr, "ERR: Could not run %s\n", ADDR2LINE);
+		perror("O/S Err:");
+		unlink(tmpname);
+		exit(EXIT_FAILURE);
+	}
+
+	// One line of output for every address, in order
+	for(unsigned k=0; k<gbl_hdr.m_npcs; k++) {
+		char	*ptr;
+
+		if (NULL == fgets(line, sizeof(line), fp))
+			break;
+		if (NULL != (ptr = strstr(line, " (discriminator")))
+			*ptr = '\0';
+		if (NULL != (ptr = strchr(line, '\n')))
+			*ptr = '\0';
+
+		STATS	&s = costs[line];
+		s.m_retired += gbl_pcs[k].m_retired;
+		s.m_stalls  += gbl_pcs[k].m_stalls;
+	}
+
+	pclose(fp);
+	unlink(tmpname);
+
+	report("source line", costs, count);
+}
+
+static	bool	callcostlier(const std::pair<int, CALLEE> &a,
+			const std::pair<int, CALLEE> &b) {
+	return a.second.m_cycles > b.second.m_cycles;
+}
+
+void	callgraph(int count) {
+	std::map<int, CALLEE>	callees;
+
+	for(unsigned k=0; k<gbl_hdr.m_narcs; k++) {
+		PROFARC	*a = &gbl_arcs[k];
+		CALLEE	&c = callees[function(a->m_entry)];
+		// A caller's STATS count its calls and their cycles
+		STATS	&s = c.m_callers[function(a->m_site)];
+
+		c.m_calls  += a->m_calls;
+		c.m_cycles += a->m_cycles;
+		s.m_retired += a->m_calls;
+		s.m_stalls  += a->m_cycles;
+	}
+
+	std::vector<std::pair<int, CALLEE> >	v(callees.begin(),
+							callees.end());
+	std::sort(v.begin(), v.end(), callcostlier);
+
+	printf("\nCall graph, by cycles from call to return\n\n");
+	printf("%6s %12s %12s  %s\n", "%Time", "Calls", "Cycles", "Function");
+	for(unsigned k=0; k<v.size() && (count <= 0 || (int)k < count); k++) {
+		CALLEE	&c = v[k].second;
+
+		printf("%6.2f %12lu %12lu  %s\n", percent(c.m_cycles),
+			(unsigned long)c.m_calls, (unsigned long)c.m_cycles,
+			fnname(v[k].first));
+		for(auto &s : c.m_callers)
+			printf("%6s %12lu %12lu    <- %s\n", "",
+				(unsigned long)s.second.m_retired,
+				(unsigned long)s.second.m_stalls,
+				fnname(s.first));
+	}
+}
+
+int	main(int argc, char **argv) {
+	const char	*elfname = NULL, *proffile = "pfile.bin";
+	bool		graph = false, lines = false;
+	int		opt, count = 0;
+
+	while((opt = getopt(argc, argv, "ghln:")) != -1) {
+		switch(opt) {
+		case 'g': graph = true; break;
+		case 'h': usage(); exit(EXIT_SUCCESS); break;
+		case 'l': lines = true; break;
+		case 'n': count = atoi(optarg); break;
+		default:
+			usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (optind >= argc) {
+		usage();
+		exit(EXIT_FAILURE);
+	}
+
+	elfname = argv[optind++];
+	if (optind < argc)
+		proffile = argv[optind++];
+
+	if (!iself(elfname)) {
+		fprintf(stderr, "ERR: %s is not an ELF file\n", elfname);
+		exit(EXIT_FAILURE);
+	}
+
+	readprof(proffile);
+	gbl_nsyms = elfsymbols(elfname, gbl_syms);
+
+	printf("%lu %s profiled\n", (unsigned long)gbl_hdr.m_ticks,
+		(gbl_hdr.m_flags & PROF_SAMPLED) ? "PC samples" : "clock ticks");
+	byfunction(count);
+	if (lines)
+		byline(elfname, count);
+	if (graph)
+		callgraph(count);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+// Filename:	zipsample.cpp
+//
+// Project:	ICO Zip, iCE40 ZipCPU demonstration project
+//
+// Purpose:	A statistical profiler for the ZipCPU, running at full speed on
+//		the board.  The CPU's PC is read, over and over, through the
+//	same R_ZIPCTRL/R_ZIPDATA window zipstate uses, but without ever
+//	setting the halt bit, so the CPU never stops.  Reads are queued up
+//	in batches, so each round trip over the link returns many samples.
+//
+//	By default, both the supervisor and user PCs are read with every
+//	sample, together with the CPU's status, so that the PC of whichever
+//	mode the CPU is in may be counted.  Selecting the register to read
+//	takes a write to R_ZIPCTRL, and any such write releases a halted
+//	CPU.  Hence, with -s or -u, only the one PC is read, the register
+//	is selected only once, and nothing more is written while sampling.
+//
+//	The samples are written out as a profile, in the format of
+//	profdata.h, so that zipprof can report them against the ELF file
+//	that was loaded.
+//
+// Creator:	Dan Gisselquist, Ph.D.
+//		Gisselquist Technology, LLC
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (C) 2021, Gisselquist Technology, LLC
+//
+// This program is free software (firmware): you can redistribute it and/or
+// modify it under the terms of  the GNU General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTIBILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with this program.  (It's in the $(ROOT)/doc directory.  Run make with no
+// target there if the PDF file isn't present.)  If not, see
+// <http://www.gnu.org/licenses/> for a copy.
+//
+// License:	GPL, v3, as defined and found on www.gnu.org,
+//		http://www.gnu.org/licenses/gpl.html
+//
+//
+////////////////////////////////////////////////////////////////////////////////
+//
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <map>
+
+#include "port.h"
+#include "regdefs.h"
+#include "hexbus.h"
+#include "busqueue.h"
+#include "profdata.h"
+
+// Samples read with every round trip across the link, by default
+#define	DEF_BATCH	64
+#define	MAXBATCH	1024
+
+// Bits of the CPU status, as read from R_ZIPCTRL
+#define	CPU_SLEEPING	0x1000
+#define	CPU_GIE		0x2000
+
+FPGA	*m_fpga;
+bool	gbl_done = false;
+
+void	closeup(int v) {
+	gbl_done = true;
+}
+
+uint64_t	now_us(void) {
+	struct	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+
+void	usage(void) {
+	printf("USAGE: zipsample [-su] [-b batch] [-c count] [-t secs] [-o file]\n"
+"\n"
+"\tSamples the PC of the running ZipCPU, without halting it, until a\n"
+"\tcontrol-C if not before, and writes out a profile of where the samples\n"
+"\tlanded.  Use zipprof to report on it.  Don't run this while the CPU\n"
+"\tis being debugged: unless -s or -u is given, it may release a halt.\n"
+"\n"
+"\t-b batch\tRead batch samples per round trip [%d]\n"
+"\t-c count\tStop after count samples\n"
+"\t-o file\tWrite the profile to file [pfile.bin]\n"
+"\t-s\tOnly sample the supervisor PC\n"
+"\t-t secs\tStop after secs seconds\n"
+"\t-u\tOnly sample the user PC\n"
+"\t-n host\tThe network host to connect to [%s]\n"
+"\t-p port\tThe network port to connect to [%d]\n",
+		DEF_BATCH, FPGAHOST, FPGAPORT);
+}
+
+/*
+ * writeprof
+ *
+ * Write the histogram out as a sampled profile, in PC order
+ */
+void	writeprof(const char *fname, std::map<uint32_t, uint64_t> &hist,
+		uint64_t nsamples) {
+	PROFHDR	hdr;
+	PROFPC	pc;
+	FILE	*fp;
+
+	if (NULL == (fp = fopen(fname, "wb"))) {
+		fprintf(stderr, "ERR: Could not create %s\n", fname);
+		perror("O/S Err:");
+		exit(EXIT_FAILURE);
+	}
+
+	hdr.m_magic   = PROF_MAGIC;
+	hdr.m_version = PROF_VERSION;
+	hdr.m_npcs    = hist.size();
+	hdr.m_narcs   = 0;
+	hdr.m_flags   = PROF_SAMPLED;
+	hdr.m_unused  = 0;
+	hdr.m_ticks   = nsamples;
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+
+	for(auto &h : hist) {
+		pc.m_pc      = h.first;
+		pc.m_unused  = 0;
+		pc.m_retired = h.second;
+		pc.m_stalls  = 0;
+		fwrite(&pc, sizeof(pc), 1, fp);
+	}
+
+	fclose(fp);
+}
+
+int main(int argc, char **argv) {
+	const char	*host = FPGAHOST, *fname = "pfile.bin";
+	int		port = FPGAPORT, opt;
+	unsigned	batch = DEF_BATCH, only = 0;
+	unsigned long	count = 0, nsamples = 0, nsleep = 0, nerrs = 0;
+	double		maxtime = 0.0;
+	bool		halted = false;
+	std::map<uint32_t, uint64_t>	hist;
+
+	while((opt = getopt(argc, argv, "b:c:hn:o:p:st:u")) != -1) {
+		switch(opt) {
+		case 'b': batch = strtoul(optarg, NULL, 0); break;
+		case 'c': count = strtoul(optarg, NULL, 0); break;
+		case 'n': host = optarg; break;
+		case 'o': fname = optarg; break;
+		case 'p': port = strtoul(optarg, NULL, 0); break;
+		case 's': only = CPU_sPC; break;
+		case 't': maxtime = atof(optarg); break;
+		case 'u': only = CPU_uPC; break;
+		case 'h': usage(); exit(EXIT_SUCCESS);
+		default:
+			usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if ((batch < 1)||(batch > MAXBATCH)) {
+		fprintf(stderr, "ERR: The batch size must be between 1 and %d\n",
+			MAXBATCH);
+		exit(EXIT_FAILURE);
+	}
+
+	m_fpga = new FPGA(new NETCOMMS(host, port));
+	signal(SIGINT, closeup);
+
+	// Never sample a halted CPU, lest we release it
+	if (m_fpga->readio(R_ZIPCTRL) & CPU_HALT) {
+		fprintf(stderr, "ERR: The CPU is halted, there's nothing to sample\n");
+		delete	m_fpga;
+		exit(EXIT_FAILURE);
+	}
+
+	// Each sample takes at most two writes and three reads
+	BUSQUEUE		q(m_fpga, 5*batch+1);
+	BUSQUEUE::HANDLE	hs[MAXBATCH], hpc[MAXBATCH], hupc[MAXBATCH],
+				hstat;
+	uint64_t		start, t;
+
+	if (only)
+		m_fpga->writeio(R_ZIPCTRL, only);
+
+	start = now_us();
+	while(!gbl_done && !halted) {
+		for(unsigned k=0; k<batch; k++) {
+			if (only) {
+				hpc[k] = q.readio(R_ZIPDATA);
+				continue;
+			}
+
+			q.writeio(R_ZIPCTRL, CPU_sPC);
+			hpc[k]  = q.readio(R_ZIPDATA);
+			q.writeio(R_ZIPCTRL, CPU_uPC);
+			hupc[k] = q.readio(R_ZIPDATA);
+			hs[k]   = q.readio(R_ZIPCTRL);
+		}
+
+		// With one PC, the status need only be checked once per batch
+		if (only)
+			hstat = q.readio(R_ZIPCTRL);
+		q.flush();
+
+		for(unsigned k=0; k<batch; k++) {
+			uint32_t	st, pc;
+
+			st = q.value((only) ? hstat : hs[k]);
+			if (q.err(hpc[k]) || (!only && (q.err(hupc[k])
+						|| q.err(hs[k])))) {
+				nerrs++;
+				continue;
+			} else if (st & CPU_HALT) {
+				halted = true;
+				break;
+			}
+
+			if (only)
+				pc = q.value(hpc[k]);
+			else if (st & CPU_GIE)
+				pc = q.value(hupc[k]);
+			else if (st & CPU_SLEEPING) {
+				// Waiting for an interrupt, in supervisor mode
+				nsleep++;
+				nsamples++;
+				continue;
+			} else
+				pc = q.value(hpc[k]);
+
+			hist[pc]++;
+			nsamples++;
+		}
+
+		t = now_us() - start;
+		if ((count)&&(nsamples >= count))
+			break;
+		if ((maxtime > 0.0)&&(t >= maxtime * 1e6))
+			break;
+	}
+
+	t = now_us() - start;
+	if (halted)
+		fprintf(stderr, "WARNING: The CPU halted, sampling stopped\n");
+
+	writeprof(fname, hist, nsamples);
+
+	fprintf(stderr, "%lu samples, of %lu PCs, in %.3f s: %.1f samples/s",
+		nsamples, (unsigned long)hist.size(), t / 1e6,
+		(t > 0) ? nsamples * 1e6 / t : 0.0);
+	if (nsleep)
+		fprintf(stderr, ", %.1f%% asleep", 100.0 * nsleep / nsamples);
+	if (nerrs)
+		fprintf(stderr, ", %lu bus errors", nerrs);
+	fprintf(stderr, "\n");
+
+	delete	m_fpga;
+	return (nerrs) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -52,6 +52,7 @@
 #include "llcomms.h"
 #include "regdefs.h"
 #include "hexbus.h"
+#include "busqueue.h"
 
 FPGA	*m_fpga;
 void	closeup(int v) {
@@ -83,6 +84,33 @@ unsigned int	cmd_read(FPGA *fpga, int r) {
 	} return fpga->readio(R_ZIPDATA);
 }
 
+/*
+ * read_regs
+ *
+ * Read all 32 registers at once.  Rather than waiting on each halt, check,
+ * and read in turn, queue them all so that they may all be in flight on the
+ * bus at the same time.  Should the CPU not have stalled in time for any one
+ * register, fall back to cmd_read() for that one.
+ */
+void	read_regs(FPGA *fpga, unsigned int *regs) {
+	BUSQUEUE		q(fpga, 128);
+	BUSQUEUE::HANDLE	hs[32], hd[32];
+
+	for(int i=0; i<32; i++) {
+		q.writeio(R_ZIPCTRL, CPU_HALT|i);
+		hs[i] = q.readio(R_ZIPCTRL);
+		hd[i] = q.readio(R_ZIPDATA);
+	} q.flush();
+
+	for(int i=0; i<32; i++) {
+		if ((!q.err(hs[i]))&&(!q.err(hd[i]))
+				&&(q.value(hs[i]) & CPU_STALL))
+			regs[i] = q.value(hd[i]);
+		else
+			regs[i] = cmd_read(fpga, i);
+	}
+}
+
 void	usage(void) {
 	printf("USAGE: zipstate\n");
 }
@@ -141,21 +169,24 @@ int main(int argc, char **argv) {
 		// if (v & 0x0800) printf("CLR-CACHE ");
 		printf("\n");
 	} else {
+		unsigned int	regs[32];
+
 		printf("Reading the long-state ...\n");
+		read_regs(m_fpga, regs);
 		for(int i=0; i<14; i++) {
-			printf("sR%-2d: 0x%08x ", i, cmd_read(m_fpga, i));
+			printf("sR%-2d: 0x%08x ", i, regs[i]);
 			if ((i&3)==3)
 				printf("\n");
-		} printf("sCC : 0x%08x ", cmd_read(m_fpga, 14));
-		printf("sPC : 0x%08x ", cmd_read(m_fpga, 15));
+		} printf("sCC : 0x%08x ", regs[14]);
+		printf("sPC : 0x%08x ", regs[15]);
 		printf("\n\n"); 
 
 		for(int i=0; i<14; i++) {
-			printf("uR%-2d: 0x%08x ", i, cmd_read(m_fpga, i+16));
+			printf("uR%-2d: 0x%08x ", i, regs[i+16]);
 			if ((i&3)==3)
 				printf("\n");
-		} printf("uCC : 0x%08x ", cmd_read(m_fpga, 14+16));
-		printf("uPC : 0x%08x ", cmd_read(m_fpga, 15+16));
+		} printf("uCC : 0x%08x ", regs[14+16]);
+		printf("uPC : 0x%08x ", regs[15+16]);
 		printf("\n\n"); 
 	}
 